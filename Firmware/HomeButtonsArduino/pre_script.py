@@ -1,6 +1,10 @@
 #!/usr/bin/env python
 
 import os
+import sys
+
+sys.path.append(os.path.join(os.getcwd(), "tools"))
+from pack_bitmaps import generate as pack_bitmaps
 
 sdkconfig_files = ["sdkconfig.original_release", "sdkconfig.original_debug",
                    "sdkconfig.mini_release", "sdkconfig.mini_debug",
@@ -22,4 +26,5 @@ def delete_sdkconfig_files():
 
 print("#### PRE SCRIPT ####")
 delete_sdkconfig_files()
+pack_bitmaps()
 print("#### PRE SCRIPT DONE ####")
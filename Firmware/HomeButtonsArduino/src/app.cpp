@@ -2,7 +2,6 @@
 
 #include <Arduino.h>
 #include <esp_task_wdt.h>
-#include <SPIFFS.h>
 #include "esp_ota_ops.h"
 #include <ArduinoJson.h>
 
@@ -103,6 +102,11 @@ void App::_start_esp_sleep() {
 }
 
 void App::_go_to_sleep() {
+#if defined(HAS_DISPLAY)
+  if (!_cancel_downloads(MDI_CANCEL_TIMEOUT)) {
+    warning("icon download still running");
+  }
+#endif
   device_state_.save_all();
 #if defined(HOME_BUTTONS_ORIGINAL) || defined(HOME_BUTTONS_MINI)
   hw_.set_all_leds(0);
@@ -252,12 +256,53 @@ void App::_start_display_task() {
   debug("m_display task started.");
   xTaskCreate(_display_task,    // Function that should be called
               "DISPLAY",        // Name of the task (for debugging)
-              5000,             // Stack size (bytes)
+              8000,             // Stack size (bytes)
               this,             // Parameter to pass
               1,                // Task priority
               &display_task_h_  // Task handle
   );
 }
+
+void App::_download_task(void* param) {
+  App* app = static_cast<App*>(param);
+  DownloadJob job;
+#if defined(HOME_BUTTONS_DOWNLOAD_BENCHMARK)
+  while (app->network_.get_state() == Network::State::DISCONNECTED) {
+    delay(100);
+  }
+  app->downloading_ = true;
+  app->mdi_.set_base_url(
+      app->device_state_.user_preferences().icon_url.c_str());
+  app->mdi_.benchmark_downloads();
+  app->downloading_ = false;
+#endif
+  while (true) {
+    // busy before the job leaves the queue, _downloads_busy() must not see
+    // an empty queue and no download in between
+    if (xQueuePeek(app->download_queue_, &job, portMAX_DELAY) != pdTRUE) {
+      continue;
+    }
+    app->downloading_ = true;
+    if (xQueueReceive(app->download_queue_, &job, 0) == pdTRUE) {
+      app->_run_downloads(job);
+    }
+    app->downloading_ = false;
+  }
+}
+
+void App::_start_download_task() {
+  if (download_task_h_ != nullptr) return;
+  download_queue_ =
+      xQueueCreate(NUM_BUTTONS + MDI_PREFETCH_MAX, sizeof(DownloadJob));
+  debug("download task started.");
+  xTaskCreate(_download_task,    // Function that should be called
+              "DOWNLOAD",        // Name of the task (for debugging)
+              12000,             // Stack size (bytes), TLS handshake
+              this,              // Parameter to pass
+              tskIDLE_PRIORITY,  // Task priority
+              &download_task_h_  // Task handle
+  );
+}
 #endif
 
 void App::_network_task(void* param) {
@@ -309,6 +354,9 @@ void App::_begin_hw() {
 
 void App::_start_tasks() {
   _start_ui_task();
+#if defined(HAS_DISPLAY)
+  _start_download_task();  // queue must exist when the network connects
+#endif
   _start_network_task();
 #if defined(HAS_DISPLAY)
   _start_display_task();
@@ -356,7 +404,7 @@ void App::_main_task() {
       device_state_.load_all(hw_);
 #if defined(HAS_DISPLAY)
       display_.disp_welcome();
-      display_.update();
+      display_.flush_cmd();
 #else
       bsl_input_.LEDBlinkAll(2, LED_DFLT_BRIGHT, 500, 400, false);
 #endif
@@ -366,7 +414,7 @@ void App::_main_task() {
       error("factory test failed!");
 #if defined(HAS_DISPLAY)
       display_.disp_error("Factory\nTest\nFailed");
-      display_.update();
+      display_.flush_cmd();
 #else
       bsl_input_.LEDBlinkAll(5, LED_DFLT_BRIGHT, 200, 160, false);
 #endif
@@ -405,7 +453,7 @@ void App::_main_task() {
       display_.disp_message(
           (UIState::MessageType("Firmware\nupdated to\n") + SW_VERSION)
               .c_str());
-      display_.update();
+      display_.flush_cmd();
 #endif
       ESP.restart();
     } else {  // first boot after factory flash
@@ -456,7 +504,7 @@ void App::_main_task() {
             warning("batt voltage too low, low bat mode enabled");
             display_.disp_message_large(
                 "Turned\nOFF\n\nPlease\nrecharge\nbattery!");
-            display_.update();
+            display_.flush_cmd();
             _go_to_sleep();
           }
         } else if (batt_voltage <= hw_.WARN_BATT_VOLT) {
@@ -503,7 +551,7 @@ void App::_main_task() {
         warning("batt voltage too low, low bat mode enabled");
         display_.disp_message_large(
             "Turned\nOFF\n\nPlease\nreplace\nbatteries!");
-        display_.update();
+        display_.flush_cmd();
         _go_to_sleep();
       }
     } else if (batt_voltage <= hw_.WARN_BATT_VOLT) {
@@ -548,20 +596,17 @@ void App::_main_task() {
 #endif
 #if defined(HAS_DISPLAY)
         display_.disp_message("RESTART...", 0);
-        delay(3000);
+        display_.wait_idle();
 #endif
       }
 
 #if defined(HAS_DISPLAY)
-      // format SPIFFS if needed
-      if (!SPIFFS.begin()) {
+      // format icon storage if needed
+      if (!icon_storage().mountable()) {
         info("Formatting icon storage...");
         display_.disp_message("Formatting\nIcon\nStorage...", 0);
-        delay(3000);
-        SPIFFS.format();
-      } else {
-        SPIFFS.end();
-        debug("SPIFFS test mount OK");
+        display_.wait_idle();
+        icon_storage().format();
       }
 #endif
 
@@ -582,9 +627,9 @@ void App::_main_task() {
           !device_state_.persisted().setup_done) {
 #if defined(HAS_DISPLAY)
         display_.disp_welcome();
-        delay(3000);
+        display_.wait_idle();
         display_.end();
-        delay(3000);
+        display_.wait_idle();
 #endif
 #if defined(HAS_SLEEP_MODE)
         _go_to_sleep();
@@ -592,7 +637,7 @@ void App::_main_task() {
       } else {
 #if defined(HAS_DISPLAY)
         display_.disp_main();
-        delay(3000);
+        display_.wait_idle();
 #endif
       }
       device_state_.persisted().download_mdi_icons = true;
@@ -608,7 +653,7 @@ void App::_main_task() {
       } else {
 #if defined(HAS_DISPLAY)
         display_.end();
-        delay(3000);
+        display_.wait_idle();
 #endif
 #if defined(HAS_SLEEP_MODE)
         _go_to_sleep();
@@ -622,23 +667,23 @@ void App::_main_task() {
         if (device_state_.persisted().charge_complete_showing) {
           device_state_.persisted().charge_complete_showing = false;
           display_.disp_main();
-          delay(3000);
+          display_.wait_idle();
           display_.end();
-          delay(3000);
+          display_.wait_idle();
           _go_to_sleep();
         } else if (device_state_.persisted().user_msg_showing) {
           device_state_.persisted().user_msg_showing = false;
           display_.disp_main();
-          delay(3000);
+          display_.wait_idle();
           display_.end();
-          delay(3000);
+          display_.wait_idle();
           _go_to_sleep();
         } else if (device_state_.persisted().check_connection) {
           device_state_.persisted().check_connection = false;
           display_.disp_main();
-          delay(3000);
+          display_.wait_idle();
           display_.end();
-          delay(3000);
+          display_.wait_idle();
           _go_to_sleep();
         } else {
           // proceed
@@ -774,7 +819,9 @@ void App::_mqtt_callback(const char* topic, const char* payload) {
 
       ButtonLabel label(device_state_.get_btn_label(i + 1).c_str());
 
-      if (label.substring(0, 4) == "mdi:") {
+      // downloaded right away, the redraw waits for it
+      if (label.substring(0, 4) == "mdi:" &&
+          !_queue_download(_get_label_icon(label), true)) {
         device_state_.persisted().download_mdi_icons = true;
       }
       return;
@@ -814,6 +861,33 @@ void App::_mqtt_callback(const char* topic, const char* payload) {
     network_.publish(topics_.t_disp_msg_cmd(), "", true);
     network_.publish(topics_.t_disp_msg_state(), "-", false);
   }
+
+  // icons to download before labels use them, e.g. "mdi:fan, mdi:lightbulb"
+  if (strcmp(topic, topics_.t_icon_prefetch_cmd().c_str()) == 0) {
+    static constexpr char SEPARATORS[] = ", \t\r\n";
+    uint8_t count = 0;
+    const char* p = payload + strspn(payload, SEPARATORS);
+    while (*p != '\0' && count < MDI_PREFETCH_MAX) {
+      size_t len = strcspn(p, SEPARATORS);
+      MDIName name("%.*s", static_cast<int>(len), p);
+      if (name.substring(0, 4) == "mdi:") {
+        name = name.substring(4, name.length());
+      }
+      if (!name.empty()) {
+        if (!_queue_download(name, true)) {
+          break;
+        }
+        count++;
+      }
+      p += len;
+      p += strspn(p, SEPARATORS);
+    }
+    if (*p != '\0') {
+      warning("icon prefetch: %u icons queued, the rest dropped", count);
+    }
+    network_.publish(topics_.t_icon_prefetch_cmd(), "", true);
+    return;
+  }
 #endif
 
 #if defined(HAS_SLEEP_MODE)
@@ -919,64 +993,175 @@ void App::_net_on_connect() {
 }
 
 #if defined(HAS_DISPLAY)
-void App::_download_mdi_icons() {
-  bool download_required = false;
-  mdi_.begin();
+MDIName App::_get_label_icon(const ButtonLabel& label) {
+  return label.substring(
+      4, label.index_of(' ') > 0 ? label.index_of(' ') : label.length());
+}
+
+uint8_t App::_get_label_icons(MDIName (&icons)[NUM_BUTTONS]) {
+  uint8_t num_icons = 0;
   for (uint8_t i = 0; i < NUM_BUTTONS; i++) {
     ButtonLabel label(device_state_.get_btn_label(i + 1).c_str());
     if (label.substring(0, 4) == "mdi:") {
-      MDIName icon = label.substring(
-          4, label.index_of(' ') > 0 ? label.index_of(' ') : label.length());
-      if (!mdi_.exists_all_sizes(icon.c_str())) {
-        download_required = true;
-        break;
-      }
+      icons[num_icons++] = _get_label_icon(label);
     }
   }
-  if (!download_required) {
-    info("no icons to download");
-    mdi_.end();
-    return;
+  return num_icons;
+}
+
+void App::_download_mdi_icons() {
+  MDIName icons[NUM_BUTTONS];
+  uint8_t num_icons = _get_label_icons(icons);
+  for (uint8_t i = 0; i < num_icons; i++) {
+    _queue_download(icons[i], false);
   }
+}
 
-  display_.disp_message("Downloading\nicons...");
+bool App::_queue_download(const MDIName& name, bool prefetch) {
+  DownloadJob job{name, 0, prefetch};
+  if (xQueueSend(download_queue_, &job, 0) != pdTRUE) {
+    warning("download queue full, '%s' dropped", name.c_str());
+    return false;
+  }
+  if (prefetch) {
+    debug("prefetching '%s'", name.c_str());
+  }
+  return true;
+}
 
-  // check if server is reachable
-  if (mdi_.check_connection()) {
-    info("icon server reachable");
-  } else {
-    warning("icon server NOT reachable");
-    mdi_.end();
-    display_.disp_error("Icon\nserver\nNOT\nreachable");
-    device_state_.flags().display_redraw = true;
-    return;
+bool App::_hold_redraw() {
+  if (!_downloads_busy()) {
+    redraw_held_ = false;
+    return false;
+  }
+  if (!redraw_held_) {
+    redraw_held_ = true;
+    redraw_hold_start_ = millis();
+    debug("redraw held back for icon downloads");
+  }
+  if (millis() - redraw_hold_start_ < MDI_REDRAW_WAIT) {
+    return true;
   }
+  warning("icons not ready after %u ms, redrawing", MDI_REDRAW_WAIT);
+  redraw_held_ = false;
+  return false;
+}
 
-  // free up space if needed
-  size_t free = mdi_.get_free_space();
-  info("SPIFFS free space: %d", free);
-  if (free < MDI_FREE_SPACE_THRESHOLD) {
-    info("making space...");
-    if (!mdi_.make_space(2 * MDI_FREE_SPACE_THRESHOLD)) {
-      error("failed to make space");
-      mdi_.end();
-      return;
+void App::_run_downloads(DownloadJob job) {
+  uint32_t start_time = millis();
+  network_.take_max_update_gap();
+  uint8_t num_downloaded = 0;
+  uint8_t num_failed = 0;
+  bool started = false;
+  bool reachable = true;
+  mdi_.begin();
+  uint32_t partial_bytes = mdi_.partial_bytes();
+  do {
+    if (cancel_downloads_) {
+      info("downloads cancelled");
+      xQueueReset(download_queue_);
+      break;
     }
-  }
+    // missing, or due for a check with the server
+    bool needed = job.size > 0
+                      ? mdi_.needs_download(job.name.c_str(), job.size)
+                      : mdi_.needs_download(job.name.c_str());
+    if (!needed) {
+      continue;
+    }
+    if (!started) {
+      started = true;
+      if (!job.prefetch) {
+        display_.disp_message("Downloading\nicons...");
+      }
 
-  info("Downloading icons...");
-  for (uint8_t i = 0; i < NUM_BUTTONS; i++) {
-    ButtonLabel label(device_state_.get_btn_label(i + 1).c_str());
-    if (label.substring(0, 4) == "mdi:") {
-      MDIName icon = label.substring(
-          4, label.index_of(' ') > 0 ? label.index_of(' ') : label.length());
-      if (!mdi_.exists_all_sizes(icon.c_str())) {
-        mdi_.download(icon.c_str());
+      // free up space if needed, icons on the labels are kept
+      size_t free = mdi_.get_free_space();
+      info("icon storage free space: %d", free);
+      MDIName icons[NUM_BUTTONS];
+      uint8_t num_icons = _get_label_icons(icons);
+      if (free < MDI_FREE_SPACE_THRESHOLD &&
+          !mdi_.make_space(MDI_FREE_SPACE_THRESHOLD, icons, num_icons)) {
+        error("failed to make space");
+        xQueueReset(download_queue_);
+        break;
       }
+      // no separate reachability check, the first download tells
+      info("Downloading icons...");
+      mdi_.set_base_url(device_state_.user_preferences().icon_url.c_str());
+      mdi_.begin_downloads();
+    }
+    bool ok = job.size > 0 ? mdi_.download(job.name.c_str(), job.size)
+                           : mdi_.download(job.name.c_str());
+    if (!ok && !mdi_.server_reachable()) {
+      reachable = false;
+      xQueueReset(download_queue_);
+      break;
+    }
+    if (ok) {
+      num_downloaded++;
+    } else {
+      num_failed++;
+      warning("failed to download '%s'", job.name.c_str());
+    }
+    if (!job.prefetch) {
+      // downloaded of all, failures on their own line
+      uint16_t total = num_downloaded + num_failed +
+                       uxQueueMessagesWaiting(download_queue_);
+      UIState::MessageType progress;
+      if (num_failed > 0) {
+        progress.set("Downloading\nicons...\n%u/%u\n%u failed",
+                     num_downloaded, total, num_failed);
+      } else {
+        progress.set("Downloading\nicons...\n%u/%u", num_downloaded, total);
+      }
+      display_.disp_message(progress.c_str());
+    }
+  } while (xQueueReceive(download_queue_, &job, 0) == pdTRUE);
+
+  if (started) {
+    mdi_.end_downloads();
+    if (mdi_.replaced_icons() > 0) {
+      info("%u icons changed on the server", mdi_.replaced_icons());
+      display_.invalidate_icons();
+    }
+    // an interrupted download that made progress continues next time
+    uint32_t partial = mdi_.partial_bytes();
+    if (partial > 0 && partial != partial_bytes) {
+      info("download interrupted at %u bytes, resuming later", partial);
+      device_state_.persisted().download_mdi_icons = true;
     }
   }
   mdi_.end();
-  device_state_.flags().display_redraw = true;
+  if (!reachable) {
+    warning("icon server NOT reachable");
+    display_.disp_error("Icon\nserver\nNOT\nreachable");
+  }
+  if (started) {
+    info("downloaded %u icons, %u failed in %u ms, longest MQTT loop gap "
+         "%u ms",
+         num_downloaded, num_failed, millis() - start_time,
+         network_.take_max_update_gap());
+    device_state_.flags().display_redraw = true;
+  }
+  cancel_downloads_ = false;
+}
+
+bool App::_downloads_busy() {
+  return downloading_ || (download_queue_ != nullptr &&
+                          uxQueueMessagesWaiting(download_queue_) > 0);
+}
+
+bool App::_cancel_downloads(uint32_t timeout) {
+  if (!_downloads_busy()) {
+    return true;
+  }
+  cancel_downloads_ = true;
+  uint32_t start = millis();
+  while (_downloads_busy() && millis() - start < timeout) {
+    delay(10);
+  }
+  return !_downloads_busy();
 }
 #endif
 
@@ -993,6 +1178,10 @@ void AppSMStates::InitState::entry() {
   sm().mdi_.add_size(92);
   sm().mdi_.add_size(64);
 #endif
+#if defined(HOME_BUTTONS_MDI_BENCHMARK)
+  sm().mdi_.benchmark_lookups(120);
+  sm().mdi_.benchmark_storage();
+#endif
 
 #if defined(HOME_BUTTONS_INDUSTRIAL)
   uint8_t amb_bright = sm().device_state_.user_preferences().led_amb_bright;
@@ -1035,6 +1224,8 @@ void AppSMStates::InitState::entry() {
 
 void AppSMStates::AwakeModeIdleState::entry() {
 #if defined(HAS_DISPLAY)
+  // keep icon storage mounted across redraws while awake
+  sm().mdi_.begin();
   sm().display_.disp_main();
 #endif
 #if defined(HAS_BUTTON_UI)
@@ -1048,6 +1239,9 @@ void AppSMStates::AwakeModeIdleState::entry() {
 
 void AppSMStates::AwakeModeIdleState::exit() {
   sm().bsl_input_.ClearEventCallback();
+#if defined(HAS_DISPLAY)
+  sm().mdi_.end();
+#endif
 }
 
 void AppSMStates::AwakeModeIdleState::loop() {
@@ -1075,12 +1269,14 @@ void AppSMStates::AwakeModeIdleState::loop() {
 #if defined(HAS_DISPLAY)
   if (millis() - sm().last_m_display_redraw_ >= AWAKE_REDRAW_INTERVAL) {
     if (sm().device_state_.flags().display_redraw) {
-      sm().device_state_.flags().display_redraw = false;
       if (sm().device_state_.persisted().download_mdi_icons) {
         sm()._download_mdi_icons();
         sm().device_state_.persisted().download_mdi_icons = false;
       }
-      sm().display_.disp_main();
+      if (!sm()._hold_redraw()) {
+        sm().device_state_.flags().display_redraw = false;
+        sm().display_.disp_main();
+      }
     }
     sm().last_m_display_redraw_ = millis();
   }
@@ -1307,6 +1503,7 @@ void AppSMStates::NetConnectingState::handle_ui_event(UserInput::Event event) {
 void AppSMStates::InfoScreenState::entry() {
 #if defined(HAS_DISPLAY)
   sm().info_screen_start_time_ = millis();
+  sm().info_screen_sensor_time_ = millis();
   sm().display_.disp_info();
 #if defined(HAS_BUTTON_UI)
   sm().bsl_input_.SetEventCallback(std::bind(&InfoScreenState::handle_ui_event,
@@ -1326,6 +1523,20 @@ void AppSMStates::InfoScreenState::exit() {
 }
 
 void AppSMStates::InfoScreenState::loop() {
+#if defined(HAS_DISPLAY) && defined(HAS_TH_SENSOR)
+  // live values, the display pushes the ones that changed with a partial
+  // refresh
+  if (sm().device_state_.flags().awake_mode &&
+      millis() - sm().info_screen_sensor_time_ >= AWAKE_REDRAW_INTERVAL) {
+    sm().hw_.read_temp_hmd(sm().device_state_.sensors().temperature,
+                           sm().device_state_.sensors().humidity,
+                           sm().device_state_.get_use_fahrenheit());
+#if defined(HAS_BATTERY)
+    sm().device_state_.sensors().battery_pct = sm().hw_.read_battery_percent();
+#endif
+    sm().info_screen_sensor_time_ = millis();
+  }
+#endif
   if (millis() - sm().info_screen_start_time_ >= INFO_SCREEN_DISP_TIME) {
     sm().debug("info screen timeout");
     if (sm().device_state_.flags().awake_mode) {
@@ -1574,6 +1785,16 @@ void AppSMStates::CmdShutdownState::entry() {
 void AppSMStates::CmdShutdownState::loop() {
   // wait for timeout
   if (millis() - sm().shutdown_cmd_time_ > SHUTDOWN_DELAY) {
+#if defined(HAS_DISPLAY)
+    // let queued icons finish downloading, up to a limit
+    if (sm()._downloads_busy()) {
+      if (millis() - sm().shutdown_cmd_time_ >
+          SHUTDOWN_DELAY + MDI_DOWNLOAD_TIMEOUT) {
+        sm()._cancel_downloads();
+      }
+      return;
+    }
+#endif
 #if defined(HAS_BUTTON_UI)
     sm().bsl_input_.Stop();
 #elif defined(HAS_TOUCH_UI)
@@ -204,7 +204,28 @@ class App : public AppStateMachine, public Logger {
   void _publish_battery();
 #endif
 #if defined(HAS_DISPLAY)
+  // Icons are downloaded on their own low priority task, so the network task
+  // keeps serving MQTT meanwhile. Jobs are queued per icon.
+  struct DownloadJob {
+    MDIName name;
+    uint16_t size;  // 0: all sizes
+    bool prefetch;  // no progress messages on the display
+  };
+  static void _download_task(void* app);
+  void _start_download_task();
+  static MDIName _get_label_icon(const ButtonLabel& label);
+  uint8_t _get_label_icons(MDIName (&icons)[NUM_BUTTONS]);
+  // queues the missing icons of the current labels
   void _download_mdi_icons();
+  // queues one icon in all sizes, false if the queue is full
+  bool _queue_download(const MDIName& name, bool prefetch);
+  // True while icons download, up to MDI_REDRAW_WAIT, so that a new label is
+  // drawn once with its icon instead of with a placeholder first.
+  bool _hold_redraw();
+  void _run_downloads(DownloadJob job);
+  bool _downloads_busy();
+  // stops after the current icon, waits up to timeout for the task to finish
+  bool _cancel_downloads(uint32_t timeout = 0);
 #endif
 
 #if defined(HAS_AWAKE_MODE)
@@ -216,6 +237,14 @@ class App : public AppStateMachine, public Logger {
   TaskHandle_t display_task_h_ = nullptr;
   TaskHandle_t network_task_h_ = nullptr;
   TaskHandle_t main_task_h_ = nullptr;
+#if defined(HAS_DISPLAY)
+  TaskHandle_t download_task_h_ = nullptr;
+  QueueHandle_t download_queue_ = nullptr;
+  volatile bool downloading_ = false;
+  volatile bool cancel_downloads_ = false;
+  bool redraw_held_ = false;
+  uint32_t redraw_hold_start_ = 0;
+#endif
 
 #if defined(HOME_BUTTONS_ORIGINAL)
   BtnSwLED b1_;
@@ -263,6 +292,7 @@ class App : public AppStateMachine, public Logger {
   uint32_t last_m_display_redraw_ = 0;
   uint32_t input_start_time_ = 0;
   uint32_t info_screen_start_time_ = 0;
+  uint32_t info_screen_sensor_time_ = 0;
   uint32_t settings_menu_start_time_ = 0;
   uint32_t device_info_start_time_ = 0;
   uint32_t shutdown_cmd_time_ = 0;
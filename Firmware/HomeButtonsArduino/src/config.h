@@ -84,6 +84,7 @@ static constexpr uint8_t NUM_BUTTONS = 5;
 static constexpr char BTN_PRESS_PAYLOAD[] = "PRESS";
 static constexpr uint8_t BTN_LABEL_MAXLEN = 56;
 static constexpr uint8_t USER_MSG_MAXLEN = 64;
+static constexpr uint8_t ICON_URL_MAXLEN = 96;
 
 // ------ defaults ------
 static constexpr char DEVICE_NAME_DFLT[] = "Home Buttons";
@@ -117,6 +118,12 @@ static constexpr uint32_t DEVICE_INFO_TIMEOUT = 30000L;       // ms
 static constexpr uint32_t SHUTDOWN_DELAY = 500L;              // ms
 static constexpr uint32_t FRONTLIGHT_TIMEOUT = 5000L;         // ms
 static constexpr uint32_t SLEEP_MODE_INPUT_TIMEOUT = 10000L;  // ms
+static constexpr uint32_t DISPLAY_IDLE_TIMEOUT = 30000L;      // ms
+static constexpr uint32_t DISPLAY_CMD_SETTLE_TIME = 100L;     // ms
+static constexpr uint32_t MDI_DOWNLOAD_TIMEOUT = 30000L;      // ms
+static constexpr uint32_t MDI_CANCEL_TIMEOUT = 2000L;         // ms
+// redraws wait this long for icons being downloaded, e.g. of a new label
+static constexpr uint32_t MDI_REDRAW_WAIT = 5000L;  // ms
 
 // ------ network ------
 static constexpr uint32_t QUICK_WIFI_TIMEOUT = 5000L;
@@ -138,9 +145,32 @@ static constexpr uint32_t MIN_FREE_HEAP = 10000UL;
 static constexpr uint32_t SCHEDULE_WAKEUP_MIN = 5;                      // s
 static constexpr uint32_t SCHEDULE_WAKEUP_MAX = SEN_INTERVAL_MAX * 60;  // s
 static constexpr uint32_t MDI_FREE_SPACE_THRESHOLD = 100000UL;
+static constexpr size_t MDI_CACHE_BUDGET = 12288UL;  // bytes, decoded icons
+// icon pack is compacted when dead bytes exceed this share of its data
+static constexpr uint8_t MDI_PACK_COMPACT_THRESHOLD = 25;  // %
+// gzip decoder window, power of 2, covers 1-bpp icons of all sizes
+static constexpr size_t MDI_GZIP_WINDOW = 8192UL;  // bytes
+// icon downloads are received in chunks of this size, with overlapped writes
+// a writer task stores one chunk while the next is received
+static constexpr size_t MDI_DOWNLOAD_BUFFER = 1024UL;  // bytes
+static constexpr bool MDI_DOWNLOAD_OVERLAP = false;
+// stored icons are checked for changes on the server after this many wakeups
+static constexpr uint32_t MDI_REVALIDATE_INTERVAL = 2000UL;
+static constexpr uint8_t MDI_VALIDATOR_MAXLEN = 80;  // ETag, Last-Modified
+// glyph font blocks are inflated whole, same as BLOCK_SIZE in pack_glyphs.py
+static constexpr size_t MDI_GLYPH_BLOCK = 4096UL;  // bytes
+// line segments of one icon outline after flattening its curves
+static constexpr uint16_t MDI_GLYPH_MAX_EDGES = 2048;
+// icons queued from one icon prefetch command
+static constexpr uint8_t MDI_PREFETCH_MAX = 16;
 static constexpr uint16_t LED_DEFAULT_FADE_TIME = 50;  // ms
 
 // ------ UI ------
+// partial refreshes (info page values) before a full refresh
+static constexpr uint8_t DISPLAY_MAX_PARTIAL_REFRESHES = 10;
+// band height for HOME_BUTTONS_PAGED_RENDERING, which replaces the canvas
+// and the frame copy (2 x frame size, see display.h) with one band buffer
+static constexpr uint16_t DISPLAY_PAGE_HEIGHT = 40;  // rows
 #if defined(HOME_BUTTONS_ORIGINAL)
 static constexpr char BATT_EMPTY_MSG[] =
     "Battery\nLOW\n\nPlease\nrecharge\nsoon!";
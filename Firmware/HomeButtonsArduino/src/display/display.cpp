@@ -1,13 +1,15 @@
 #include "display.h"
 
+#include <Adafruit_GFX.h>
 #include <GxEPD2_BW.h>
-#include <SPIFFS.h>
+#include <FS.h>
 #include <U8g2_for_Adafruit_GFX.h>
 #include <qrcode.h>
 
-#include "bitmaps.h"
+#include "bitmaps_packed.h"
 #include "config.h"
 #include "hardware.h"
+#include "utils.h"
 
 #if defined(HOME_BUTTONS_ORIGINAL)
 static constexpr uint16_t ROTATION = 0;
@@ -23,6 +25,42 @@ static constexpr uint16_t WIDTH = 400;
 static constexpr uint16_t HEIGHT = 300;
 #endif
 
+// fallback in case a BUSY edge is missed, GxEPD2 re-checks the pin after
+static constexpr uint32_t BUSY_WAIT_MAX = 100;  // ms
+
+// Panel state kept in RTC memory across deep sleep. The controller RAM
+// survives hibernate(), so a warm panel is initialized without blanking and
+// a frame that is already on it is not refreshed again. Other frames get a
+// full refresh as after a cold start. Reset at every boot that is not a
+// wake from deep sleep, RTC memory may survive a reset or brownout that
+// the panel didn't.
+struct PanelState {
+  uint32_t magic;
+  uint32_t frame_hash;    // frame on the panel, 0 if unknown
+  uint8_t partial_count;  // partial refreshes since the last full one
+};
+static constexpr uint32_t PANEL_STATE_MAGIC = 0x48425031;
+RTC_DATA_ATTR static PanelState panel_state = {};
+
+static constexpr char MAIN_LIST_PATH[] = "/main.dl";
+
+// pre-rendered frames of static pages are kept in CACHE_FOLDER, dropped by
+// MDIHelper::make_space() before any icon
+static constexpr uint32_t FRAME_MAGIC = 0x46424248;  // "HBBF"
+
+// fonts referenced by display list text runs
+static const uint8_t *const LIST_FONTS[] = {u8g2_font_helvB24_te,
+                                            u8g2_font_helvB18_te};
+
+#if defined(HOME_BUTTONS_PAGED_RENDERING)
+// frames are not hashed in paged mode, the panel only holds a known frame
+static constexpr uint32_t PAGED_FRAME_HASH = 1;
+#endif
+
+static bool panel_warm() {
+  return panel_state.magic == PANEL_STATE_MAGIC && panel_state.frame_hash != 0;
+}
+
 uint16_t read16(File &f) {
   // BMP data is stored little-endian, same as Arduino.
   uint16_t result;
@@ -54,45 +92,162 @@ LabelType Display::get_label_type(ButtonLabel label) {
   }
 }
 
-MDIName Display::get_mdi_name(ButtonLabel label) {
-  if (get_label_type(label) == LabelType::Icon) {
-    return MDIName{label.substring(4)};
-  } else if (get_label_type(label) == LabelType::Mixed) {
-    return MDIName{label.substring(4, label.index_of(' '))};
-  } else {
-    return MDIName{};
+// Returns the longest prefix of label followed by "." that fits max_width
+// (strictly narrower if strict). Glyphs are measured once, the cut is found
+// by binary search over the cumulative widths.
+ButtonLabel Display::trim_text(ButtonLabel label, uint16_t max_width,
+                               bool strict) {
+  auto fits = [&](uint16_t w) {
+    return strict ? w < max_width : w <= max_width;
+  };
+  if (fits(u8g2.getUTF8Width(label.c_str()))) {
+    return label;
   }
-}
 
-ButtonLabel Display::get_text(ButtonLabel label) {
-  if (get_label_type(label) == LabelType::Text) {
+  const char *str = label.c_str();
+  size_t len = label.length();
+  uint8_t ends[BTN_LABEL_MAXLEN + 1] = {0};     // byte offset after glyph
+  uint16_t widths[BTN_LABEL_MAXLEN + 1] = {0};  // cumulative width
+  uint8_t n = 0;
+  char glyph[5];
+  for (size_t pos = 0; pos < len;) {
+    size_t next = pos + 1;
+    while (next < len && (str[next] & 0xC0) == 0x80) next++;  // UTF-8
+    size_t glyph_len = std::min(next - pos, sizeof(glyph) - 1);
+    memcpy(glyph, str + pos, glyph_len);
+    glyph[glyph_len] = '\0';
+    widths[n + 1] = widths[n] + u8g2.getUTF8Width(glyph);
+    ends[++n] = next;
+    pos = next;
+  }
+  if (n == 0) {
     return label;
-  } else if (get_label_type(label) == LabelType::Mixed) {
-    return label.substring(label.index_of(' ') + 1);
-  } else {
-    return ButtonLabel{};
   }
+
+  uint16_t dot_width = u8g2.getUTF8Width(".");
+  uint8_t lo = 0;
+  uint8_t hi = n - 1;
+  while (lo < hi) {
+    uint8_t mid = (lo + hi + 1) / 2;
+    if (fits(widths[mid] + dot_width)) {
+      lo = mid;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  ButtonLabel trimmed = label.substring(0, ends[lo]) + ".";
+  // sum of single glyphs might differ slightly from the string width
+  while (lo > 0 && !fits(u8g2.getUTF8Width(trimmed.c_str()))) {
+    lo--;
+    trimmed = label.substring(0, ends[lo]) + ".";
+  }
+  return trimmed;
 }
 
-ButtonLabel Display::trim_text(ButtonLabel label, uint16_t max_width) {
-  uint16_t w = u8g2.getUTF8Width(label.c_str());
-  while (w > max_width) {
-    label = label.substring(0, label.length() - 2) + ".";
-    w = u8g2.getUTF8Width(label.c_str());
+LabelLayout &Display::get_layout(uint8_t idx) {
+  LabelLayout &layout = label_layouts[idx];
+  ButtonLabel label = device_state_.get_btn_label(idx + 1);
+  if (layout.type != LabelType::None && layout.label == label) {
+    return layout;
+  }
+  layout = {};
+  layout.label = label;
+  layout.type = get_label_type(label);
+  int space = label.index_of(' ');
+  switch (layout.type) {
+    case LabelType::Icon:
+      layout.icon = MDIName{label.substring(4)};
+      break;
+    case LabelType::Mixed:
+      layout.icon = MDIName{label.substring(4, space)};
+      layout.text = label.substring(space + 1);
+      break;
+    default:
+      layout.text = label;
+      break;
   }
-  return label;
+  return layout;
+}
+
+// Selects the large font if the text fits, the small one otherwise and trims
+// the text if it still doesn't fit. Leaves the selected font set in u8g2.
+const LabelLayout &Display::fit_label(uint8_t idx, uint16_t max_width,
+                                      bool allow_large, bool strict) {
+  LabelLayout &layout = get_layout(idx);
+  if (layout.font != nullptr && layout.max_width == max_width &&
+      layout.allow_large == allow_large && layout.strict == strict) {
+    u8g2.setFont(layout.font);
+    return layout;
+  }
+
+  ButtonLabel text = layout.text;
+  const uint8_t *font =
+      allow_large ? u8g2_font_helvB24_te : u8g2_font_helvB18_te;
+#if defined(HOME_BUTTONS_ORIGINAL)
+  if (text.index_of('_') == 0) {
+    // force small font
+    text = text.substring(1);
+    font = u8g2_font_helvB18_te;
+  }
+#endif
+  u8g2.setFont(font);
+  uint16_t w = u8g2.getUTF8Width(text.c_str());
+  if (w >= max_width && font != u8g2_font_helvB18_te) {
+    font = u8g2_font_helvB18_te;
+    u8g2.setFont(font);
+    w = u8g2.getUTF8Width(text.c_str());
+  }
+  if (strict ? w >= max_width : w > max_width) {
+    text = trim_text(text, max_width, strict);
+    w = u8g2.getUTF8Width(text.c_str());
+  }
+
+  layout.max_width = max_width;
+  layout.allow_large = allow_large;
+  layout.strict = strict;
+  layout.font = font;
+  layout.fitted = text;
+  layout.width = w;
+  return layout;
 }
 
 void Display::begin(HardwareDefinition &HW) {
   if (state != State::IDLE) return;
-  disp = new GxEPD2_DISPLAY_CLASS<GxEPD2_DRIVER_CLASS,
-                                  MAX_HEIGHT(GxEPD2_DRIVER_CLASS)>(
-      GxEPD2_DRIVER_CLASS(/*CS=*/HW.EINK_CS, /*DC=*/HW.EINK_DC,
-                          /*RST=*/HW.EINK_RST, /*BUSY=*/HW.EINK_BUSY));
-  disp->init(0, false);
-  u8g2.begin(*disp);
+  if (disp == nullptr) {
+    // not a wake from deep sleep, the panel state is unknown
+    if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_UNDEFINED) {
+      panel_state = {};
+    }
+    disp = new GxEPD2_DISPLAY_CLASS<EPDDriver, PANEL_BUFFER_HEIGHT(EPDDriver)>(
+        EPDDriver(/*CS=*/HW.EINK_CS, /*DC=*/HW.EINK_DC,
+                  /*RST=*/HW.EINK_RST, /*BUSY=*/HW.EINK_BUSY));
+    size_t buffer_size =
+        EPDDriver::WIDTH / 8 * PANEL_BUFFER_HEIGHT(EPDDriver);
+#if defined(HOME_BUTTONS_PAGED_RENDERING)
+    gfx = disp;
+#else
+    canvas = new GFXcanvas1(WIDTH, HEIGHT);
+    gfx = canvas;
+    frame = new uint8_t[WIDTH / 8 * HEIGHT];
+    buffer_size += 2 * (WIDTH / 8 * HEIGHT);
+#endif
+    info("frame buffers: %u bytes", buffer_size);
+  }
+  // the panel is initialized before the first refresh, wakes without
+  // drawing leave it hibernating
+  panel_ready = false;
+  refresh_started = false;
+  partial_count = panel_warm() ? panel_state.partial_count : 0;
+  busy_pin = HW.EINK_BUSY;
+  disp->epd2.setBusyCallback(busy_callback, this);
+  attachInterruptArg(busy_pin, busy_isr, this, FALLING);
+  u8g2.begin(*gfx);
+  ahead_ready = false;
   current_ui_state = {};
-  cmd_ui_state = {};
+  portENTER_CRITICAL(&cmd_mux);
+  cmd_queue_len = 0;
+  drawn_seq = cmd_seq;
+  portEXIT_CRITICAL(&cmd_mux);
   draw_ui_state = {};
   pre_disappear_ui_state = {};
   state = State::ACTIVE;
@@ -108,23 +263,29 @@ void Display::end() {
 void Display::update() {
   if (state == State::IDLE) return;
 
-  if (state == State::CMD_END && !new_ui_cmd) {
+  uint32_t seq = drawn_seq;
+  bool composed = false;
+
+  if (ahead_ready) {
+    // composed while the previous frame was refreshing
+    draw_ui_state = ahead_ui_state;
+    seq = ahead_seq;
+    ahead_ui_state = {};
+    ahead_ready = false;
+    composed = true;
+  } else if (state == State::CMD_END && !cmd_pending()) {
     state = State::ENDING;
     if (current_ui_state.disappearing) {
       draw_ui_state = pre_disappear_ui_state;
     } else {
-      disp->hibernate();
-      state = State::IDLE;
-      info("ended.");
+      hibernate();
       return;
     }
   } else if (current_ui_state.disappearing) {
     if (millis() - current_ui_state.appear_time >=
         current_ui_state.disappear_timeout) {
-      if (new_ui_cmd) {
-        draw_ui_state = cmd_ui_state;
-        cmd_ui_state = {};
-        new_ui_cmd = false;
+      if (cmd_pending()) {
+        if (!pop_cmd(draw_ui_state, seq)) return;  // wait for settle
       } else {
         draw_ui_state = pre_disappear_ui_state;
         pre_disappear_ui_state = {};
@@ -132,13 +293,24 @@ void Display::update() {
     } else {
       return;
     }
-  } else if (new_ui_cmd) {
-    if (cmd_ui_state.disappearing) {
+  } else if (cmd_pending()) {
+    if (!pop_cmd(draw_ui_state, seq)) return;  // wait for settle
+    if (draw_ui_state.disappearing) {
       pre_disappear_ui_state = current_ui_state;
     }
-    draw_ui_state = cmd_ui_state;
-    cmd_ui_state = {};
-    new_ui_cmd = false;
+  } else if (current_ui_state.page == DisplayPage::INFO &&
+             state == State::ACTIVE &&
+             millis() - last_info_check >= AWAKE_REDRAW_INTERVAL) {
+    last_info_check = millis();
+    redraw_in_progress = true;
+    if (update_info_values()) {
+      debug("info values: transfer: %u us, refresh: %u us, partials: %u",
+            disp->epd2.transfer_us(), disp->epd2.refresh_us(),
+            partial_count);
+      disp->epd2.reset_timing();
+    }
+    redraw_in_progress = false;
+    return;
   } else {
     return;
   }
@@ -148,7 +320,131 @@ void Display::update() {
         draw_ui_state.message.c_str());
 
   redraw_in_progress = true;
-  switch (draw_ui_state.page) {
+  if (!composed) {
+    compose(draw_ui_state);
+  }
+  present();
+  debug("transfer: %u us, refresh: %u us, cmds: %u, refreshes: %u",
+        disp->epd2.transfer_us(), disp->epd2.refresh_us(), cmd_seq,
+        refresh_count);
+  disp->epd2.reset_timing();
+  current_ui_state = draw_ui_state;
+  current_ui_state.appear_time = millis();
+  draw_ui_state = {};
+  if (seq > drawn_seq) drawn_seq = seq;
+  redraw_in_progress = false;
+
+  if (state == State::ENDING) {
+    hibernate();
+  }
+}
+
+void Display::flush_cmd() {
+  portENTER_CRITICAL(&cmd_mux);
+  cmd_flush = cmd_queue_len > 0;
+  portEXIT_CRITICAL(&cmd_mux);
+  update();
+}
+
+#if defined(HOME_BUTTONS_PAGED_RENDERING)
+// The page is only recorded here, present() replays it once per band.
+void Display::compose(const UIState &ui_state) { paged_ui_state = ui_state; }
+#else
+void Display::compose(const UIState &ui_state) {
+  uint32_t start = micros();
+  uint32_t key = frame_key(ui_state.page);
+  if (key != 0 && load_frame(ui_state.page, key)) {
+    debug("loaded page %d in %u us", static_cast<int>(ui_state.page),
+          micros() - start);
+    return;
+  }
+  draw_page(ui_state);
+  if (key != 0) {
+    save_frame(ui_state.page, key);
+  }
+  debug("composed page %d in %u us", static_cast<int>(ui_state.page),
+        micros() - start);
+}
+
+// Key of a pre-rendered frame: page, firmware and the inputs the page shows.
+// Returns 0 for pages that are not cached.
+uint32_t Display::frame_key(DisplayPage page) {
+  uint32_t hash = 2166136261UL;
+  auto add = [&hash](const char *str) {
+    hash = fnv1a(reinterpret_cast<const uint8_t *>(str), strlen(str) + 1,
+                 hash);
+  };
+  const auto &factory = device_state_.factory();
+  switch (page) {
+    case DisplayPage::WELCOME:
+      add(factory.serial_number.c_str());
+      add(factory.model_id.c_str());
+      add(factory.hw_version.c_str());
+      add(factory.unique_id.c_str());
+      break;
+    case DisplayPage::SETTINGS:
+      add(device_state_.device_name().c_str());
+      add(factory.model_id.c_str());
+      add(factory.hw_version.c_str());
+      add(factory.unique_id.c_str());
+      break;
+    case DisplayPage::AP_CONFIG:
+      add(device_state_.get_ap_ssid().c_str());
+      add(device_state_.get_ap_password());
+      break;
+    case DisplayPage::WEB_CONFIG:
+      add(device_state_.ip());
+      break;
+    default:
+      return 0;
+  }
+  add(SW_MODEL_ID);
+  add(SW_VERSION);
+  uint8_t page_id = static_cast<uint8_t>(page);
+  hash = fnv1a(&page_id, 1, hash);
+  return hash != 0 ? hash : 1;
+}
+
+bool Display::load_frame(DisplayPage page, uint32_t key) {
+  MDIHelper::Session session(mdi_);
+  StaticString<24> path("%s/frame%u", CACHE_FOLDER,
+                        static_cast<uint8_t>(page));
+  File file = mdi_.open(path.c_str());
+  if (!file) return false;
+  uint32_t header[2] = {};
+  size_t len = (WIDTH + 7) / 8 * HEIGHT;
+  bool ok = file.read(reinterpret_cast<uint8_t *>(header), sizeof(header)) ==
+                sizeof(header) &&
+            header[0] == FRAME_MAGIC && header[1] == key &&
+            file.read(canvas->getBuffer(), len) == len;
+  file.close();
+  return ok;
+}
+
+void Display::save_frame(DisplayPage page, uint32_t key) {
+  MDIHelper::Session session(mdi_);
+  StaticString<24> path("%s/frame%u", CACHE_FOLDER,
+                        static_cast<uint8_t>(page));
+  File file = mdi_.open(path.c_str(), FILE_WRITE);
+  if (!file) {
+    warning("failed to open '%s'", path.c_str());
+    return;
+  }
+  uint32_t header[2] = {FRAME_MAGIC, key};
+  size_t len = (WIDTH + 7) / 8 * HEIGHT;
+  bool ok = file.write(reinterpret_cast<const uint8_t *>(header),
+                       sizeof(header)) == sizeof(header) &&
+            file.write(canvas->getBuffer(), len) == len;
+  file.close();
+  if (!ok) {
+    warning("failed to write '%s'", path.c_str());
+    mdi_.remove_file(path.c_str());
+  }
+}
+#endif
+
+void Display::draw_page(const UIState &ui_state) {
+  switch (ui_state.page) {
     case DisplayPage::EMPTY:
       draw_white();
       break;
@@ -162,13 +458,13 @@ void Display::update() {
       draw_device_info();
       break;
     case DisplayPage::MESSAGE:
-      draw_message(draw_ui_state.message);
+      draw_message(ui_state.message);
       break;
     case DisplayPage::MESSAGE_LARGE:
-      draw_message(draw_ui_state.message, false, true);
+      draw_message(ui_state.message, false, true);
       break;
     case DisplayPage::ERROR:
-      draw_message(draw_ui_state.message, true, false);
+      draw_message(ui_state.message, true, false);
       break;
     case DisplayPage::WELCOME:
       draw_welcome();
@@ -183,20 +479,204 @@ void Display::update() {
       draw_web_config();
       break;
     case DisplayPage::TEST:
-      draw_test(draw_ui_state.message.c_str(), draw_ui_state.mdi_name.c_str(),
-                draw_ui_state.mdi_size);
+      draw_test(ui_state.message.c_str(), ui_state.mdi_name.c_str(),
+                ui_state.mdi_size);
       break;
   }
-  current_ui_state = draw_ui_state;
-  current_ui_state.appear_time = millis();
-  draw_ui_state = {};
-  redraw_in_progress = false;
+}
 
-  if (state == State::ENDING) {
+void Display::init_panel() {
+  bool warm = panel_warm();
+  uint32_t start = micros();
+  disp->init(0, !warm);
+  panel_ready = true;
+  panel_state.magic = PANEL_STATE_MAGIC;
+  info("panel init (%s): %u us", warm ? "warm" : "cold", micros() - start);
+}
+
+#if defined(HOME_BUTTONS_PAGED_RENDERING)
+// Replays the recorded page into the band buffer once per band. GxEPD2
+// transfers each band and refreshes after the last one, panels with
+// differential updates take a second pass to write the old image RAM.
+void Display::render_pages() {
+  uint32_t start = micros();
+  uint8_t passes = 0;
+  // storage stays mounted for all bands and the main page list is read
+  // once, the bands replay it from memory
+  MDIHelper::Session mdi_session(mdi_);
+  if (paged_ui_state.page == DisplayPage::MAIN && !icons_invalid) {
+    load_main_list(main_list_key());
+  }
+  presenting = true;
+  refresh_started = true;
+  disp->firstPage();
+  do {
+    draw_page(paged_ui_state);
+    passes++;
+  } while (disp->nextPage());
+  presenting = false;
+  debug("paged: %u passes of %u rows in %u us (incl. refresh)", passes,
+        DISPLAY_PAGE_HEIGHT, micros() - start);
+}
+
+void Display::present() {
+  if (!panel_ready) {
+    init_panel();
+  }
+  disp->setFullWindow();
+  panel_state.frame_hash = 0;
+  render_pages();
+  refresh_count++;
+  partial_count = 0;
+  panel_state.frame_hash = PAGED_FRAME_HASH;
+  panel_state.partial_count = 0;
+}
+
+void Display::present_window(const Area &area) {
+  if (!panel_ready) {
+    init_panel();
+  }
+  disp->setPartialWindow(area.x, area.y, area.w, area.h);
+  panel_state.frame_hash = 0;
+  render_pages();
+  refresh_count++;
+  partial_count++;
+  panel_state.frame_hash = PAGED_FRAME_HASH;
+  panel_state.partial_count = partial_count;
+}
+#else
+// Same sequence as GxEPD2_BW::display(), out of the frame copy. The canvas
+// has the layout of the controller RAM (MSB first, rotation 0), so the copy
+// is a memcpy.
+void Display::present() {
+  uint32_t hash = fnv1a(canvas->getBuffer(), WIDTH / 8 * HEIGHT);
+  if (panel_warm() && hash == panel_state.frame_hash && partial_count == 0) {
+    debug("frame already on the panel, refresh skipped");
+    return;
+  }
+  if (!panel_ready) {
+    init_panel();
+  }
+  memcpy(frame, canvas->getBuffer(), WIDTH / 8 * HEIGHT);
+  panel_state.frame_hash = 0;  // unknown if interrupted
+  presenting = true;
+  refresh_started = true;
+  disp->epd2.writeImageForFullRefresh(frame, 0, 0, WIDTH, HEIGHT);
+  disp->epd2.refresh(false);
+  if (disp->epd2.hasFastPartialUpdate) {
+    disp->epd2.writeImageAgain(frame, 0, 0, WIDTH, HEIGHT);
+  }
+  disp->epd2.powerOff();
+  presenting = false;
+  refresh_count++;
+  partial_count = 0;
+  panel_state.frame_hash = hash;
+  panel_state.partial_count = 0;
+}
+
+// Pushes an area of the canvas with a partial refresh, same sequence as
+// GxEPD2_BW::displayWindow(). Only the rows of the window are copied and
+// only the window is transferred.
+void Display::present_window(const Area &area) {
+  if (!panel_ready) {
+    init_panel();
+  }
+  memcpy(frame + area.y * (WIDTH / 8),
+         canvas->getBuffer() + area.y * (WIDTH / 8), area.h * (WIDTH / 8));
+  // before the refresh, the next frame may be composed during it
+  uint32_t hash = fnv1a(canvas->getBuffer(), WIDTH / 8 * HEIGHT);
+  panel_state.frame_hash = 0;
+  presenting = true;
+  refresh_started = true;
+  disp->epd2.writeImagePart(frame, area.x, area.y, WIDTH, HEIGHT, area.x,
+                            area.y, area.w, area.h);
+  disp->epd2.refresh(area.x, area.y, area.w, area.h);
+  if (disp->epd2.hasFastPartialUpdate) {
+    disp->epd2.writeImagePartAgain(frame, area.x, area.y, WIDTH, HEIGHT,
+                                   area.x, area.y, area.w, area.h);
+  }
+  presenting = false;
+  refresh_count++;
+  partial_count++;
+  panel_state.frame_hash = hash;
+  panel_state.partial_count = partial_count;
+}
+#endif
+
+// Composes the next command into the canvas while the panel is refreshing.
+// Disappearing messages are left to update(), they depend on the state
+// after the refresh.
+void Display::compose_ahead() {
+#if defined(HOME_BUTTONS_PAGED_RENDERING)
+  // the band buffer is in use until the refresh is done
+#else
+  if (!presenting || ahead_ready || state != State::ACTIVE) return;
+  if (draw_ui_state.disappearing) return;
+  if (!pop_cmd(ahead_ui_state, ahead_seq, false)) return;
+  debug("compose ahead: page: %d", static_cast<int>(ahead_ui_state.page));
+  compose(ahead_ui_state);
+  ahead_ready = true;
+#endif
+}
+
+void Display::hibernate() {
+  if (!panel_ready && !panel_warm()) {
+    init_panel();  // unknown controller state, make sure it sleeps
+  }
+  if (panel_ready) {
     disp->hibernate();
-    state = State::IDLE;
-    info("ended.");
+    panel_ready = false;
+    refresh_started = false;
   }
+  detachInterrupt(busy_pin);
+  state = State::IDLE;
+  info("ended.");
+}
+
+bool Display::busy() {
+  if (state == State::IDLE) return false;
+  if (state == State::CMD_END || state == State::ENDING) return true;
+  if (redraw_in_progress || cmd_pending() || ahead_ready) return true;
+  if (drawn_seq != cmd_seq) return true;
+  // Panel might still be busy after a refresh started outside update().
+  // Only then, a panel not initialized this wake or hibernating may hold
+  // BUSY high.
+  if (!panel_ready || !refresh_started) return false;
+  if (busy_pin >= 0 && digitalRead(busy_pin) == HIGH) return true;
+  refresh_started = false;
+  return false;
+}
+
+bool Display::wait_idle(uint32_t timeout) {
+  uint32_t start = millis();
+  while (busy()) {
+    if (millis() - start >= timeout) {
+      warning("wait idle timeout");
+      return false;
+    }
+    delay(10);
+  }
+  return true;
+}
+
+void IRAM_ATTR Display::busy_isr(void *arg) {
+  Display *display = static_cast<Display *>(arg);
+  if (display->busy_wait_task == nullptr) return;
+  BaseType_t task_woken = pdFALSE;
+  vTaskNotifyGiveFromISR(display->busy_wait_task, &task_woken);
+  if (task_woken == pdTRUE) {
+    portYIELD_FROM_ISR();
+  }
+}
+
+// called by GxEPD2 while BUSY is active
+void Display::busy_callback(const void *arg) {
+  Display *display = static_cast<Display *>(const_cast<void *>(arg));
+  display->compose_ahead();
+  display->busy_wait_task = xTaskGetCurrentTaskHandle();
+  ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(BUSY_WAIT_MAX));
+  // later BUSY edges must not notify a task that stopped waiting
+  display->busy_wait_task = nullptr;
 }
 
 void Display::disp_message(const char *message, uint32_t duration) {
@@ -283,20 +763,79 @@ void Display::init_ui_state(UIState ui_state) { current_ui_state = ui_state; }
 Display::State Display::get_state() { return state; }
 
 void Display::set_cmd_state(UIState cmd) {
-  cmd_ui_state = cmd;
-  new_ui_cmd = true;
+  portENTER_CRITICAL(&cmd_mux);
+  uint32_t seq = ++cmd_seq;
+  last_cmd_time = millis();
+  if (!cmd.disappearing) {
+    // only the last persistent page would stay visible
+    uint8_t len = 0;
+    for (uint8_t i = 0; i < cmd_queue_len; i++) {
+      if (cmd_queue[i].ui_state.disappearing) {
+        cmd_queue[len++] = cmd_queue[i];
+      }
+    }
+    cmd_queue_len = len;
+  }
+  if (cmd_queue_len >= CMD_QUEUE_SIZE) {
+    // drop oldest
+    for (uint8_t i = 1; i < cmd_queue_len; i++) {
+      cmd_queue[i - 1] = cmd_queue[i];
+    }
+    cmd_queue_len--;
+  }
+  cmd_queue[cmd_queue_len++] = {cmd, seq};
+  portEXIT_CRITICAL(&cmd_mux);
+}
+
+static uint8_t get_cmd_priority(const UIState &ui_state) {
+  switch (ui_state.page) {
+    case DisplayPage::ERROR:
+      return 2;
+    case DisplayPage::MESSAGE:
+    case DisplayPage::MESSAGE_LARGE:
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+bool Display::pop_cmd(UIState &ui_state, uint32_t &seq,
+                      bool allow_disappearing) {
+  bool ret = false;
+  portENTER_CRITICAL(&cmd_mux);
+  if (cmd_queue_len > 0 &&
+      (cmd_flush || millis() - last_cmd_time >= DISPLAY_CMD_SETTLE_TIME)) {
+    uint8_t idx = 0;
+    for (uint8_t i = 1; i < cmd_queue_len; i++) {
+      if (get_cmd_priority(cmd_queue[i].ui_state) >
+          get_cmd_priority(cmd_queue[idx].ui_state)) {
+        idx = i;
+      }
+    }
+    if (allow_disappearing || !cmd_queue[idx].ui_state.disappearing) {
+      ui_state = cmd_queue[idx].ui_state;
+      seq = cmd_queue[idx].seq;
+      for (uint8_t i = idx + 1; i < cmd_queue_len; i++) {
+        cmd_queue[i - 1] = cmd_queue[i];
+      }
+      cmd_queue_len--;
+      cmd_flush = false;
+      ret = true;
+    }
+  }
+  portEXIT_CRITICAL(&cmd_mux);
+  return ret;
 }
 
 void Display::draw_message(const UIState::MessageType &message, bool error,
                            bool large) {
-  disp->setRotation(ROTATION);
-  disp->setFullWindow();
+  gfx->setRotation(ROTATION);
 
   u8g2.setFontMode(1);
   u8g2.setForegroundColor(text_color);
   u8g2.setBackgroundColor(bg_color);
 
-  disp->fillScreen(bg_color);
+  gfx->fillScreen(bg_color);
 
 #if defined(HOME_BUTTONS_ORIGINAL)
   if (!error) {
@@ -361,42 +900,138 @@ void Display::draw_message(const UIState::MessageType &message, bool error,
     u8g2.print(message.c_str());
   }
 #endif
-
-  disp->display();
 }
 
 void Display::draw_main() {
-  disp->setRotation(ROTATION);
-  disp->setFullWindow();
+  gfx->setRotation(ROTATION);
 
   u8g2.setFontMode(1);
   u8g2.setForegroundColor(text_color);
   u8g2.setBackgroundColor(bg_color);
 
-  disp->fillScreen(bg_color);
+  gfx->fillScreen(bg_color);
 
 #if defined(HOME_BUTTONS_ORIGINAL)
-  const uint16_t min_btn_clearance = 14;
-  const uint16_t h_padding = 5;
-
   // charging line
   if (device_state_.sensors().charging) {
-    disp->fillRect(12, HEIGHT - 3, WIDTH - 24, 3, text_color);
+    gfx->fillRect(12, HEIGHT - 3, WIDTH - 24, 3, text_color);
+  }
+#endif
+
+  // one storage session for all icons of the frame
+  MDIHelper::Session mdi_session(mdi_);
+
+  if (icons_invalid) {
+    icons_invalid = false;
+    mdi_.cache().clear();
+    main_list.clear();
+    mdi_.remove_file(MAIN_LIST_PATH);
+  }
+  uint32_t key = main_list_key();
+  if (load_main_list(key)) {
+    replay_main_list();
+  } else {
+    uint32_t start = micros();
+    main_list.begin_record(key);
+    draw_buttons();
+    if (main_list.end_record()) {
+      File file = mdi_.open(MAIN_LIST_PATH, FILE_WRITE);
+      if (file) {
+        main_list.save(file);
+        file.close();
+      }
+    }
+    debug("main page compiled in %u us", micros() - start);
+  }
+
+#if defined(HOME_BUTTONS_PRO)
+  // grid
+  uint16_t tile_height = 100;
+  gfx->drawFastHLine(0, tile_height, WIDTH, text_color);
+  gfx->drawFastHLine(0, 2 * tile_height, WIDTH, text_color);
+  gfx->drawFastVLine(133, 0, HEIGHT, text_color);
+  gfx->drawFastVLine(266, 0, HEIGHT, text_color);
+#endif
+}
+
+// Key of the main page display list, changes with the labels and with the
+// firmware (layout).
+uint32_t Display::main_list_key() {
+  uint32_t hash = fnv1a(reinterpret_cast<const uint8_t *>(SW_VERSION),
+                        strlen(SW_VERSION));
+  for (uint8_t i = 0; i < NUM_BUTTONS; i++) {
+    ButtonLabel label = device_state_.get_btn_label(i + 1);
+    hash = fnv1a(reinterpret_cast<const uint8_t *>(label.c_str()),
+                 label.length() + 1, hash);
+  }
+  return hash;
+}
+
+bool Display::load_main_list(uint32_t key) {
+  if (main_list.valid(key)) return true;
+  File file = mdi_.open(MAIN_LIST_PATH);
+  if (!file) return false;
+  bool ok = main_list.load(file, key);
+  file.close();
+  return ok;
+}
+
+void Display::replay_main_list() {
+  uint32_t start = micros();
+  for (uint8_t i = 0; i < main_list.size(); i++) {
+    const DisplayList::Op &op = main_list.op(i);
+    const uint8_t *data = main_list.data() + op.offset;
+    if (op.type == DisplayList::OP_BITMAP) {
+      gfx->drawBitmap(op.x, op.y, data, op.w, op.h, GxEPD_BLACK,
+                      GxEPD_WHITE);
+      if (op.icon != 0) {
+        mdi_.mark_used(op.icon, op.w);  // icons are op.w wide
+      }
+    } else if (op.font < sizeof(LIST_FONTS) / sizeof(LIST_FONTS[0])) {
+      char text[BTN_LABEL_MAXLEN + 2];
+      size_t len = std::min<size_t>(op.w, sizeof(text) - 1);
+      memcpy(text, data, len);
+      text[len] = '\0';
+      u8g2.setFont(LIST_FONTS[op.font]);
+      u8g2.setCursor(op.x, op.y);
+      u8g2.print(text);
+    }
+  }
+  debug("main page replayed in %u us", micros() - start);
+}
+
+// Prints text with the given font and records it if a display list is being
+// recorded.
+void Display::draw_text(const uint8_t *font, int16_t x, int16_t y,
+                        const char *text) {
+  u8g2.setFont(font);
+  u8g2.setCursor(x, y);
+  u8g2.print(text);
+  if (!main_list.recording()) return;
+  for (uint8_t i = 0; i < sizeof(LIST_FONTS) / sizeof(LIST_FONTS[0]); i++) {
+    if (LIST_FONTS[i] == font) {
+      main_list.add_text(x, y, i, text);
+      return;
+    }
   }
+  main_list.abort_record();
+}
+
+// Button labels of the main page, recorded into the main page display list.
+void Display::draw_buttons() {
+#if defined(HOME_BUTTONS_ORIGINAL)
+  const uint16_t min_btn_clearance = 14;
+  const uint16_t h_padding = 5;
 
-  mdi_.begin();
   LabelType label_type[NUM_BUTTONS] = {};
   for (uint16_t i = 0; i < NUM_BUTTONS; i++) {
-    ButtonLabel label = device_state_.get_btn_label(i + 1);
-    label_type[i] = get_label_type(label);
+    label_type[i] = get_layout(i).type;
   }
 
   // Loop through buttons
   for (uint16_t i = 0; i < NUM_BUTTONS; i++) {
-    ButtonLabel label = device_state_.get_btn_label(i + 1);
-
     if (label_type[i] == LabelType::Icon) {
-      MDIName icon = get_mdi_name(label);
+      const MDIName &icon = get_layout(i).icon;
 
       // make smaller if opposite is text or mixed
       uint16_t size;
@@ -448,8 +1083,7 @@ void Display::draw_main() {
       }
       draw_mdi(icon.c_str(), size, x, y);
     } else if (label_type[i] == LabelType::Mixed) {
-      MDIName icon = get_mdi_name(label);
-      ButtonLabel text = get_text(label);
+      const MDIName &icon = get_layout(i).icon;
       uint16_t icon_size = 48;
       uint16_t x = i % 2 == 0 ? 0 : WIDTH - icon_size;
       uint16_t y =
@@ -459,67 +1093,20 @@ void Display::draw_main() {
       draw_mdi(icon.c_str(), icon_size, x, y);
       // draw text
       uint16_t max_text_width = WIDTH - icon_size - h_padding;
-      if (text.index_of('_') == 0) {
-        // force small font
-        text = text.substring(1);
-        u8g2.setFont(u8g2_font_helvB18_te);
-      } else {
-        u8g2.setFont(u8g2_font_helvB24_te);
-      }
-      uint16_t w, h;
-      w = u8g2.getUTF8Width(text.c_str());
-      h = u8g2.getFontAscent();
-      if (w >= max_text_width) {
-        u8g2.setFont(u8g2_font_helvB18_te);
-        w = u8g2.getUTF8Width(text.c_str());
-        h = u8g2.getFontAscent();
-        if (w >= max_text_width) {
-          text = text.substring(0, text.length() - 1) + ".";
-          while (1) {
-            w = u8g2.getUTF8Width(text.c_str());
-            h = u8g2.getFontAscent();
-            if (w >= max_text_width) {
-              text = text.substring(0, text.length() - 2) + ".";
-            } else {
-              break;
-            }
-          }
-        }
-      }
+      const LabelLayout &layout = fit_label(i, max_text_width, true, true);
+      const ButtonLabel &text = layout.fitted;
+      uint16_t w = layout.width;
+      uint16_t h = u8g2.getFontAscent();
       x = i % 2 == 0 ? icon_size + h_padding
                      : WIDTH - icon_size - w - h_padding;
       y = static_cast<uint16_t>(round(HEIGHT / 12. + i * HEIGHT / 6.)) + h / 2;
-      u8g2.setCursor(x, y);
-      u8g2.print(text.c_str());
+      draw_text(layout.font, x, y, text.c_str());
     } else {
       uint16_t max_label_width = WIDTH - min_btn_clearance;
-      if (label.index_of('_') == 0) {
-        // force small font
-        label = label.substring(1);
-        u8g2.setFont(u8g2_font_helvB18_te);
-      } else {
-        u8g2.setFont(u8g2_font_helvB24_te);
-      }
-      uint16_t w, h;
-      w = u8g2.getUTF8Width(label.c_str());
-      h = u8g2.getFontAscent();
-      if (w >= max_label_width) {
-        u8g2.setFont(u8g2_font_helvB18_te);
-        w = u8g2.getUTF8Width(label.c_str());
-        h = u8g2.getFontAscent();
-        if (w >= max_label_width) {
-          label = label.substring(0, label.length() - 1) + ".";
-          while (1) {
-            w = u8g2.getUTF8Width(label.c_str());
-            h = u8g2.getFontAscent();
-            if (w >= max_label_width) {
-              label = label.substring(0, label.length() - 2) + ".";
-            } else {
-              break;
-            }
-          }
-        }
-      }
+      const LabelLayout &layout = fit_label(i, max_label_width, true, true);
+      const ButtonLabel &label = layout.fitted;
+      uint16_t w = layout.width;
+      uint16_t h = u8g2.getFontAscent();
       int16_t x, y;
       if (i % 2 == 0) {
         x = h_padding;
@@ -527,35 +1114,25 @@ void Display::draw_main() {
         x = WIDTH - w - h_padding;
       }
       y = static_cast<uint16_t>(round(HEIGHT / 12. + i * HEIGHT / 6.)) + h / 2;
-      u8g2.setCursor(x, y);
-      u8g2.print(label.c_str());
+      draw_text(layout.font, x, y, label.c_str());
     }
   }
-  mdi_.end();
 
 #elif defined(HOME_BUTTONS_MINI)
-  mdi_.begin();
   // Loop through buttons
   for (uint16_t i = 0; i < NUM_BUTTONS; i++) {
-    ButtonLabel label = device_state_.get_btn_label(i + 1);
     uint16_t size = 100;
     uint16_t x = i % 2 == 0 ? 0 : WIDTH - size;
     uint16_t y = i < 2 ? 0 : HEIGHT - size;
-    MDIName icon = get_mdi_name(label);
-    draw_mdi(icon.c_str(), size, x, y);
+    draw_mdi(get_layout(i).icon.c_str(), size, x, y);
   }
-  mdi_.end();
 
 #elif defined(HOME_BUTTONS_PRO)
   uint16_t tile_width = 132;
   uint16_t tile_height = 100;
   for (uint16_t i = 0; i < NUM_BUTTONS; i++) {
-    ButtonLabel label = device_state_.get_btn_label(i + 1);
-
     ButtonTile tile = {};
-    tile.label_type = get_label_type(label);
-    tile.text = get_text(label);
-    tile.mdi_name = get_mdi_name(label);
+    tile.index = i;
     tile.width = tile_width;
     tile.height = tile_height;
 
@@ -563,30 +1140,23 @@ void Display::draw_main() {
     int16_t y = i / 3 * tile.height;
     tile.draw(*this, x, y, text_color);
   }
-  // grid
-  disp->drawFastHLine(0, tile_height, WIDTH, text_color);
-  disp->drawFastHLine(0, 2 * tile_height, WIDTH, text_color);
-  disp->drawFastVLine(133, 0, HEIGHT, text_color);
-  disp->drawFastVLine(266, 0, HEIGHT, text_color);
-
 #endif
 
-  disp->display();
+  debug("icon cache: %u hits, %u misses, %u/%u bytes", mdi_.cache().hits(),
+        mdi_.cache().misses(), mdi_.cache().used(), mdi_.cache().budget());
 }
 
 void Display::draw_info() {
-  disp->setRotation(ROTATION);
-  disp->setFullWindow();
+  gfx->setRotation(ROTATION);
 
   u8g2.setFontMode(1);
   u8g2.setForegroundColor(text_color);
   u8g2.setBackgroundColor(bg_color);
 
-  disp->fillScreen(bg_color);
-
-  UIState::MessageType text;
+  gfx->fillScreen(bg_color);
 
 #if defined(HOME_BUTTONS_ORIGINAL)
+  UIState::MessageType text;
   uint16_t w;
 
   text = "- Temp -";
@@ -595,12 +1165,7 @@ void Display::draw_info() {
   u8g2.setCursor(WIDTH / 2 - w / 2, 30);
   u8g2.print(text.c_str());
 
-  text = UIState::MessageType("%.1f %s", device_state_.sensors().temperature,
-                              device_state_.get_temp_unit().c_str());
-  u8g2.setFont(u8g2_font_helvB24_te);
-  w = u8g2.getUTF8Width(text.c_str());
-  u8g2.setCursor(WIDTH / 2 - w / 2 - 2, 70);
-  u8g2.print(text.c_str());
+  draw_info_value(INFO_TEMP);
 
   text = "- Humd -";
   u8g2.setFont(u8g2_font_courR12_tr);
@@ -608,11 +1173,7 @@ void Display::draw_info() {
   u8g2.setCursor(WIDTH / 2 - w / 2, 129);
   u8g2.print(text.c_str());
 
-  text = UIState::MessageType("%.0f %%", device_state_.sensors().humidity);
-  u8g2.setFont(u8g2_font_helvB24_te);
-  w = u8g2.getUTF8Width(text.c_str());
-  u8g2.setCursor(WIDTH / 2 - w / 2 - 2, 169);
-  u8g2.print(text.c_str());
+  draw_info_value(INFO_HUMD);
 
   text = "- Batt -";
   u8g2.setFont(u8g2_font_courR12_tr);
@@ -620,54 +1181,29 @@ void Display::draw_info() {
   u8g2.setCursor(WIDTH / 2 - w / 2, 228);
   u8g2.print(text.c_str());
 
-  if (device_state_.sensors().battery_present) {
-    text = UIState::MessageType("%d %%", device_state_.sensors().battery_pct);
-  } else {
-    text = "-";
-  }
-  u8g2.setFont(u8g2_font_helvB24_te);
-  w = u8g2.getUTF8Width(text.c_str());
-  u8g2.setCursor(WIDTH / 2 - w / 2 - 2, 268);
-  u8g2.print(text.c_str());
+  draw_info_value(INFO_BATT);
 
 #elif defined(HOME_BUTTONS_MINI)
-  u8g2.setFont(u8g2_font_helvB24_tr);
-
-  disp->drawXBitmap(5, 4, thermometer_64x64, 64, 64, text_color);
-  text = UIState::MessageType("%.1f %s", device_state_.sensors().temperature,
-                              device_state_.get_temp_unit().c_str());
-  u8g2.setCursor(85, 50);
-  u8g2.print(text.c_str());
+  blit(5, 4, thermometer_64x64_packed, 64, 64);
+  draw_info_value(INFO_TEMP);
 
-  disp->drawXBitmap(5, 68, water_percent_64x64, 64, 64, text_color);
-  text = UIState::MessageType("%.0f %%", device_state_.sensors().humidity);
-  u8g2.setCursor(85, 116);
-  u8g2.print(text.c_str());
+  blit(5, 68, water_percent_64x64_packed, 64, 64);
+  draw_info_value(INFO_HUMD);
 
-  disp->drawXBitmap(5, 132, battery_64x64, 64, 64, text_color);
-  text = UIState::MessageType("%d %%", device_state_.sensors().battery_pct);
-  u8g2.setCursor(85, 180);
-  u8g2.print(text.c_str());
+  blit(5, 132, battery_64x64_packed, 64, 64);
+  draw_info_value(INFO_BATT);
 
 #elif defined(HOME_BUTTONS_PRO)
-  u8g2.setFont(u8g2_font_helvB24_tr);
+  blit(100, 30, thermometer_64x64_packed, 64, 64);
+  draw_info_value(INFO_TEMP);
 
-  disp->drawXBitmap(100, 30, thermometer_64x64, 64, 64, text_color);
-  text = UIState::MessageType("%.1f %s", device_state_.sensors().temperature,
-                              device_state_.get_temp_unit().c_str());
-  int8_t ascent = u8g2.getFontAscent();
-  u8g2.setCursor(180, 30 + 64 / 2 + ascent / 2);
-  u8g2.print(text.c_str());
+  blit(100, 110, water_percent_64x64_packed, 64, 64);
+  draw_info_value(INFO_HUMD);
 
-  disp->drawXBitmap(100, 110, water_percent_64x64, 64, 64, text_color);
-  text = UIState::MessageType("%.0f %%", device_state_.sensors().humidity);
-  u8g2.setCursor(180, 110 + 64 / 2 + ascent / 2);
-  u8g2.print(text.c_str());
-
-  disp->drawLine(20, 200, 380, 200, text_color);
+  gfx->drawLine(20, 200, 380, 200, text_color);
 
   // device info
-  disp->drawXBitmap(6, 210, hb_logo_64x64, 64, 64, text_color);
+  blit(6, 210, hb_logo_64x64_packed, 64, 64);
 
   u8g2.setFont(u8g2_font_profont12_tr);
 
@@ -694,30 +1230,121 @@ void Display::draw_info() {
   u8g2.print(ip_info.c_str());
 
   // settings icon
-  disp->drawXBitmap(WIDTH - 70, HEIGHT - 90, cog_64x64, 64, 64, text_color);
+  blit(WIDTH - 70, HEIGHT - 90, cog_64x64_packed, 64, 64);
   u8g2.setCursor(357, 285);
   u8g2.print("5s");
 
   // up chevron
-  disp->drawXBitmap(WIDTH / 2 - 32 / 2, HEIGHT - 28, chevron_up_32x32, 32, 32,
-                    text_color);
+  blit(WIDTH / 2 - 32 / 2, HEIGHT - 28, chevron_up_32x32_packed, 32, 32);
 #endif
+}
 
-  disp->display();
+UIState::MessageType Display::format_info_value(InfoValue idx) {
+  switch (idx) {
+    case INFO_TEMP:
+      return UIState::MessageType("%.1f %s",
+                                  device_state_.sensors().temperature,
+                                  device_state_.get_temp_unit().c_str());
+    case INFO_HUMD:
+      return UIState::MessageType("%.0f %%", device_state_.sensors().humidity);
+    case INFO_BATT:
+#if defined(HOME_BUTTONS_ORIGINAL)
+      if (!device_state_.sensors().battery_present) {
+        return UIState::MessageType("-");
+      }
+#endif
+      return UIState::MessageType("%d %%",
+                                  device_state_.sensors().battery_pct);
+    default:
+      return UIState::MessageType{};
+  }
+}
+
+// Draws a value of the info page and remembers it for update_info_values().
+// If area is given, the value area is cleared first and returned.
+void Display::draw_info_value(InfoValue idx, Area *area) {
+  UIState::MessageType text = format_info_value(idx);
+  info_values[idx] = text;
+
+#if defined(HOME_BUTTONS_ORIGINAL)
+  static constexpr int16_t baselines[] = {70, 169, 268};
+  u8g2.setFont(u8g2_font_helvB24_te);
+  int16_t area_x = 0;
+  int16_t x = WIDTH / 2 - u8g2.getUTF8Width(text.c_str()) / 2 - 2;
+  int16_t y = baselines[idx];
+#elif defined(HOME_BUTTONS_MINI)
+  static constexpr int16_t baselines[] = {50, 116, 180};
+  u8g2.setFont(u8g2_font_helvB24_tr);
+  int16_t area_x = 85;
+  int16_t x = area_x;
+  int16_t y = baselines[idx];
+#elif defined(HOME_BUTTONS_PRO)
+  static constexpr int16_t icon_y[] = {30, 110};
+  u8g2.setFont(u8g2_font_helvB24_tr);
+  int16_t area_x = 180;
+  int16_t x = area_x;
+  int16_t y = icon_y[idx] + 64 / 2 + u8g2.getFontAscent() / 2;
+#endif
+
+  if (area != nullptr) {
+    area->x = area_x;
+    area->y = y - u8g2.getFontAscent();
+    area->w = WIDTH - area_x;
+    area->h = u8g2.getFontAscent() - u8g2.getFontDescent() + 1;
+    gfx->fillRect(area->x, area->y, area->w, area->h, bg_color);
+  }
+  u8g2.setCursor(x, y);
+  u8g2.print(text.c_str());
+}
+
+// Redraws the info page values whose formatted text changed and pushes them
+// with a single partial refresh of their bounding area. Every
+// DISPLAY_MAX_PARTIAL_REFRESHES partial refreshes a full refresh cleans up
+// the ghosting instead.
+bool Display::update_info_values() {
+  u8g2.setFontMode(1);
+  u8g2.setForegroundColor(text_color);
+  u8g2.setBackgroundColor(bg_color);
+
+  Area bounds = {WIDTH, HEIGHT, 0, 0};
+  int16_t bottom = 0;
+  int16_t right = 0;
+  for (uint8_t i = 0; i < NUM_INFO_VALUES; i++) {
+    InfoValue idx = static_cast<InfoValue>(i);
+    if (format_info_value(idx) == info_values[idx]) continue;
+    Area area;
+    draw_info_value(idx, &area);
+    bounds.x = std::min(bounds.x, area.x);
+    bounds.y = std::min(bounds.y, area.y);
+    right = std::max<int16_t>(right, area.x + area.w);
+    bottom = std::max<int16_t>(bottom, area.y + area.h);
+  }
+  if (right == 0) {
+    return false;
+  }
+
+  if (partial_count >= DISPLAY_MAX_PARTIAL_REFRESHES) {
+    debug("info values: full refresh after %u partial", partial_count);
+    present();
+  } else {
+    bounds.w = right - bounds.x;
+    bounds.h = bottom - bounds.y;
+    present_window(bounds);
+  }
+  return true;
 }
 
 void Display::draw_device_info() {
-  disp->setRotation(ROTATION);
-  disp->setFullWindow();
+  gfx->setRotation(ROTATION);
 
   u8g2.setFontMode(1);
   u8g2.setForegroundColor(text_color);
   u8g2.setBackgroundColor(bg_color);
 
-  disp->fillScreen(bg_color);
+  gfx->fillScreen(bg_color);
 
 #if defined(HOME_BUTTONS_ORIGINAL)
-  disp->drawXBitmap(40, 0, hb_logo_48x48, 48, 48, text_color);
+  blit(40, 0, hb_logo_48x48_packed, 48, 48);
 
   u8g2.setFont(u8g2_font_profont12_tr);
 
@@ -754,7 +1381,7 @@ void Display::draw_device_info() {
   u8g2.print(batt_volt.c_str());
 
 #elif defined(HOME_BUTTONS_MINI)
-  disp->drawXBitmap(76, 0, hb_logo_48x48, 48, 48, text_color);
+  blit(76, 0, hb_logo_48x48_packed, 48, 48);
 
   u8g2.setFont(u8g2_font_profont17_tr);
 
@@ -786,7 +1413,7 @@ void Display::draw_device_info() {
   u8g2.print(batt_volt.c_str());
 
 #elif defined(HOME_BUTTONS_PRO)
-  disp->drawXBitmap(76, 0, hb_logo_48x48, 48, 48, text_color);
+  blit(76, 0, hb_logo_48x48_packed, 48, 48);
 
   u8g2.setFont(u8g2_font_profont17_tr);
 
@@ -817,19 +1444,16 @@ void Display::draw_device_info() {
   u8g2.setCursor(0, 180);
   u8g2.print(batt_volt.c_str());
 #endif
-
-  disp->display();
 }
 
 void Display::draw_welcome() {
-  disp->setRotation(ROTATION);
-  disp->setFullWindow();
+  gfx->setRotation(ROTATION);
 
   u8g2.setFontMode(1);
   u8g2.setForegroundColor(text_color);
   u8g2.setBackgroundColor(bg_color);
 
-  disp->fillScreen(bg_color);
+  gfx->fillScreen(bg_color);
 
 #if defined(HOME_BUTTONS_ORIGINAL)
   uint16_t w;
@@ -839,7 +1463,7 @@ void Display::draw_welcome() {
   u8g2.setCursor(WIDTH / 2 - w / 2, 40);
   u8g2.print(text);
 
-  disp->drawXBitmap(52, 52, hb_logo_24x24, 24, 24, GxEPD_BLACK);
+  blit(52, 52, hb_logo_24x24_packed, 24, 24);
 
   text = "------------------------";
   u8g2.setFont(u8g2_font_helvB12_tr);
@@ -848,9 +1472,6 @@ void Display::draw_welcome() {
   u8g2.print(text);
 
   uint8_t version = 6;  // 41x41px
-  QRCode qrcode;
-  uint8_t qrcodeData[qrcode_getBufferSize(version)];
-  qrcode_initText(&qrcode, qrcodeData, version, ECC_HIGH, DOCS_LINK);
 
   text = "Setup guide:";
   u8g2.setFont(u8g2_font_courR12_tr);
@@ -860,15 +1481,7 @@ void Display::draw_welcome() {
 
   uint16_t qr_x = 23;
   uint16_t qr_y = 165;
-  for (uint8_t y2 = 0; y2 < qrcode.size; y2++) {
-    // Each horizontal module
-    for (uint8_t x2 = 0; x2 < qrcode.size; x2++) {
-      // Display each module
-      if (qrcode_getModule(&qrcode, x2, y2)) {
-        disp->drawRect(qr_x + x2 * 2, qr_y + y2 * 2, 2, 2, GxEPD_BLACK);
-      }
-    }
-  }
+  draw_qr(qr_x, qr_y, DOCS_LINK, version, 2);
 
   u8g2.setFont(u8g2_font_profont12_tr);
   UIState::MessageType sw_ver = UIState::MessageType("SW: ") + SW_VERSION;
@@ -887,24 +1500,13 @@ void Display::draw_welcome() {
 
 #elif defined(HOME_BUTTONS_MINI)
   uint8_t version = 8;  // 49x49px
-  QRCode qrcode;
-  uint8_t qrcodeData[qrcode_getBufferSize(version)];
-  qrcode_initText(&qrcode, qrcodeData, version, ECC_HIGH, DOCS_LINK);
   uint16_t qr_x = 2;
   uint16_t qr_y = 2;
-  for (uint8_t y2 = 0; y2 < qrcode.size; y2++) {
-    // Each horizontal module
-    for (uint8_t x2 = 0; x2 < qrcode.size; x2++) {
-      // Display each module
-      if (qrcode_getModule(&qrcode, x2, y2)) {
-        disp->fillRect(qr_x + x2 * 4, qr_y + y2 * 4, 4, 4, GxEPD_BLACK);
-      }
-    }
-  }
-  disp->fillRect(66, 66, 68, 68, GxEPD_WHITE);
-  disp->drawXBitmap(68, 68, hb_logo_64x64, 64, 64, GxEPD_BLACK);
+  draw_qr(qr_x, qr_y, DOCS_LINK, version, 4);
+  gfx->fillRect(66, 66, 68, 68, GxEPD_WHITE);
+  blit(68, 68, hb_logo_64x64_packed, 64, 64);
 
-  disp->fillRect(34, 186, 132, 14, GxEPD_WHITE);
+  gfx->fillRect(34, 186, 132, 14, GxEPD_WHITE);
   u8g2.setFont(u8g2_font_profont17_tr);
   const char *text = device_state_.factory().serial_number.c_str();
   uint16_t w = u8g2.getUTF8Width(text);
@@ -919,7 +1521,7 @@ void Display::draw_welcome() {
   u8g2.setCursor(WIDTH / 2 - w / 2, 40);
   u8g2.print(text);
 
-  disp->drawXBitmap(52, 52, hb_logo_24x24, 24, 24, GxEPD_BLACK);
+  blit(52, 52, hb_logo_24x24_packed, 24, 24);
 
   text = "------------------------";
   u8g2.setFont(u8g2_font_helvB12_tr);
@@ -928,9 +1530,6 @@ void Display::draw_welcome() {
   u8g2.print(text);
 
   uint8_t version = 6;  // 41x41px
-  QRCode qrcode;
-  uint8_t qrcodeData[qrcode_getBufferSize(version)];
-  qrcode_initText(&qrcode, qrcodeData, version, ECC_HIGH, DOCS_LINK);
 
   text = "Setup guide:";
   u8g2.setFont(u8g2_font_courR12_tr);
@@ -940,15 +1539,7 @@ void Display::draw_welcome() {
 
   uint16_t qr_x = 23;
   uint16_t qr_y = 165;
-  for (uint8_t y2 = 0; y2 < qrcode.size; y2++) {
-    // Each horizontal module
-    for (uint8_t x2 = 0; x2 < qrcode.size; x2++) {
-      // Display each module
-      if (qrcode_getModule(&qrcode, x2, y2)) {
-        disp->drawRect(qr_x + x2 * 2, qr_y + y2 * 2, 2, 2, GxEPD_BLACK);
-      }
-    }
-  }
+  draw_qr(qr_x, qr_y, DOCS_LINK, version, 2);
 
   u8g2.setFont(u8g2_font_profont12_tr);
   UIState::MessageType sw_ver = UIState::MessageType("SW: ") + SW_VERSION;
@@ -965,27 +1556,24 @@ void Display::draw_welcome() {
   u8g2.setCursor(0, 294);
   u8g2.print(device_state_.factory().unique_id.c_str());
 #endif
-
-  disp->display();
 }
 
 void Display::draw_settings() {
-  disp->setRotation(ROTATION);
-  disp->setFullWindow();
+  gfx->setRotation(ROTATION);
 
   u8g2.setFontMode(1);
   u8g2.setForegroundColor(text_color);
   u8g2.setBackgroundColor(bg_color);
 
-  disp->fillScreen(bg_color);
+  gfx->fillScreen(bg_color);
 
 #if defined(HOME_BUTTONS_ORIGINAL)
-  disp->drawXBitmap(0, 17, account_cog_64x64, 64, 64, text_color);
-  disp->drawXBitmap(WIDTH / 2, 17, wifi_cog_64x64, 64, 64, text_color);
-  disp->drawXBitmap(0, 116, restore_64x64, 64, 64, text_color);
-  disp->drawXBitmap(WIDTH / 2, 116, close_64x64, 64, 64, text_color);
+  blit(0, 17, account_cog_64x64_packed, 64, 64);
+  blit(WIDTH / 2, 17, wifi_cog_64x64_packed, 64, 64);
+  blit(0, 116, restore_64x64_packed, 64, 64);
+  blit(WIDTH / 2, 116, close_64x64_packed, 64, 64);
 
-  disp->drawXBitmap(40, 200, hb_logo_48x48, 48, 48, text_color);
+  blit(40, 200, hb_logo_48x48_packed, 48, 48);
 
   u8g2.setFont(u8g2_font_profont12_tr);
 
@@ -1007,10 +1595,10 @@ void Display::draw_settings() {
   u8g2.print(device_state_.factory().unique_id.c_str());
 
 #elif defined(HOME_BUTTONS_MINI)
-  disp->drawXBitmap(0, 0, account_cog_100x100, 100, 100, text_color);
-  disp->drawXBitmap(100, 0, wifi_cog_100x100, 100, 100, text_color);
-  disp->drawXBitmap(0, 100, restore_100x100, 100, 100, text_color);
-  disp->drawXBitmap(100, 100, close_100x100, 100, 100, text_color);
+  blit(0, 0, account_cog_100x100_packed, 100, 100);
+  blit(100, 0, wifi_cog_100x100_packed, 100, 100);
+  blit(0, 100, restore_100x100_packed, 100, 100);
+  blit(100, 100, close_100x100_packed, 100, 100);
 
 #elif defined(HOME_BUTTONS_PRO)
   uint16_t x_icon = 310;
@@ -1018,28 +1606,26 @@ void Display::draw_settings() {
   u8g2.setFont(u8g2_font_helvB18_te);
   int8_t ascent = u8g2.getFontAscent();
 
-  disp->drawXBitmap(x_icon, 5, account_cog_64x64, 64, 64, text_color);
+  blit(x_icon, 5, account_cog_64x64_packed, 64, 64);
   u8g2.setCursor(x_text, 5 + 64 / 2 + ascent / 2);
   u8g2.print("Setup");
-  disp->drawFastHLine(0, 74, WIDTH, text_color);
+  gfx->drawFastHLine(0, 74, WIDTH, text_color);
 
-  disp->drawXBitmap(x_icon, 79, wifi_cog_64x64, 64, 64, text_color);
+  blit(x_icon, 79, wifi_cog_64x64_packed, 64, 64);
   u8g2.setCursor(x_text, 79 + 64 / 2 + ascent / 2);
   u8g2.print("Wi-Fi Setup");
-  disp->drawFastHLine(0, 149, WIDTH, text_color);
+  gfx->drawFastHLine(0, 149, WIDTH, text_color);
 
-  disp->drawXBitmap(x_icon, 154, restore_64x64, 64, 64, text_color);
+  blit(x_icon, 154, restore_64x64_packed, 64, 64);
   u8g2.setCursor(x_text, 154 + 64 / 2 + ascent / 2);
   u8g2.print("Restart");
-  disp->drawFastHLine(0, 224, WIDTH, text_color);
+  gfx->drawFastHLine(0, 224, WIDTH, text_color);
 
-  disp->drawXBitmap(x_icon, 229, close_64x64, 64, 64, text_color);
+  blit(x_icon, 229, close_64x64_packed, 64, 64);
   u8g2.setCursor(x_text, 229 + 64 / 2 + ascent / 2);
   u8g2.print("Exit");
 
 #endif
-
-  disp->display();
 }
 
 void Display::draw_ap_config() {
@@ -1048,20 +1634,16 @@ void Display::draw_ap_config() {
                                   ";P:" + device_state_.get_ap_password() +
                                   ";;";
 
-  disp->setRotation(ROTATION);
-  disp->setFullWindow();
+  gfx->setRotation(ROTATION);
 
   u8g2.setFontMode(1);
   u8g2.setForegroundColor(text_color);
   u8g2.setBackgroundColor(bg_color);
 
-  disp->fillScreen(bg_color);
+  gfx->fillScreen(bg_color);
 
 #if defined(HOME_BUTTONS_ORIGINAL)
   uint8_t version = 6;  // 41x41px
-  QRCode qrcode;
-  uint8_t qrcodeData[qrcode_getBufferSize(version)];
-  qrcode_initText(&qrcode, qrcodeData, version, ECC_HIGH, contents.c_str());
 
   u8g2.setFont(u8g2_font_courR12_tr);
 
@@ -1073,15 +1655,7 @@ void Display::draw_ap_config() {
 
   uint16_t qr_x = 23;
   uint16_t qr_y = 35;
-  for (uint8_t y2 = 0; y2 < qrcode.size; y2++) {
-    // Each horizontal module
-    for (uint8_t x2 = 0; x2 < qrcode.size; x2++) {
-      // Display each module
-      if (qrcode_getModule(&qrcode, x2, y2)) {
-        disp->drawRect(qr_x + x2 * 2, qr_y + y2 * 2, 2, 2, GxEPD_BLACK);
-      }
-    }
-  }
+  draw_qr(qr_x, qr_y, contents.c_str(), version, 2);
   text = "--------- or ---------";
   u8g2.setFont(u8g2_font_helvB12_tr);
   w = u8g2.getUTF8Width(text);
@@ -1109,24 +1683,13 @@ void Display::draw_ap_config() {
 
 #elif defined(HOME_BUTTONS_MINI)
   uint8_t version = 8;  // 49x49px
-  QRCode qrcode;
-  uint8_t qrcodeData[qrcode_getBufferSize(version)];
-  qrcode_initText(&qrcode, qrcodeData, version, ECC_HIGH, contents.c_str());
   uint16_t qr_x = 2;
   uint16_t qr_y = 2;
-  for (uint8_t y2 = 0; y2 < qrcode.size; y2++) {
-    // Each horizontal module
-    for (uint8_t x2 = 0; x2 < qrcode.size; x2++) {
-      // Display each module
-      if (qrcode_getModule(&qrcode, x2, y2)) {
-        disp->fillRect(qr_x + x2 * 4, qr_y + y2 * 4, 4, 4, GxEPD_BLACK);
-      }
-    }
-  }
-  disp->fillRect(66, 66, 68, 68, GxEPD_WHITE);
-  disp->drawXBitmap(68, 68, wifi_cog_64x64, 64, 64, GxEPD_BLACK);
+  draw_qr(qr_x, qr_y, contents.c_str(), version, 4);
+  gfx->fillRect(66, 66, 68, 68, GxEPD_WHITE);
+  blit(68, 68, wifi_cog_64x64_packed, 64, 64);
 
-  disp->fillRect(34, 186, 132, 14, GxEPD_WHITE);
+  gfx->fillRect(34, 186, 132, 14, GxEPD_WHITE);
   u8g2.setFont(u8g2_font_profont17_tr);
   const char *text = device_state_.get_ap_ssid().c_str();
   uint16_t w = u8g2.getUTF8Width(text);
@@ -1135,9 +1698,6 @@ void Display::draw_ap_config() {
 
 #elif defined(HOME_BUTTONS_PRO)
   uint8_t version = 6;  // 41x41px
-  QRCode qrcode;
-  uint8_t qrcodeData[qrcode_getBufferSize(version)];
-  qrcode_initText(&qrcode, qrcodeData, version, ECC_HIGH, contents.c_str());
 
   u8g2.setFont(u8g2_font_courR12_tr);
 
@@ -1149,15 +1709,7 @@ void Display::draw_ap_config() {
 
   uint16_t qr_x = 23;
   uint16_t qr_y = 35;
-  for (uint8_t y2 = 0; y2 < qrcode.size; y2++) {
-    // Each horizontal module
-    for (uint8_t x2 = 0; x2 < qrcode.size; x2++) {
-      // Display each module
-      if (qrcode_getModule(&qrcode, x2, y2)) {
-        disp->drawRect(qr_x + x2 * 2, qr_y + y2 * 2, 2, 2, GxEPD_BLACK);
-      }
-    }
-  }
+  draw_qr(qr_x, qr_y, contents.c_str(), version, 2);
   text = "--------- or ---------";
   u8g2.setFont(u8g2_font_helvB12_tr);
   w = u8g2.getUTF8Width(text);
@@ -1183,28 +1735,22 @@ void Display::draw_ap_config() {
   u8g2.setCursor(0, 275);
   u8g2.print(device_state_.get_ap_password());
 #endif
-
-  disp->display();
 }
 
 void Display::draw_web_config() {
   UIState::MessageType contents =
       UIState::MessageType("http://") + device_state_.ip();
 
-  disp->setRotation(ROTATION);
-  disp->setFullWindow();
+  gfx->setRotation(ROTATION);
 
   u8g2.setFontMode(1);
   u8g2.setForegroundColor(text_color);
   u8g2.setBackgroundColor(bg_color);
 
-  disp->fillScreen(bg_color);
+  gfx->fillScreen(bg_color);
 
 #if defined(HOME_BUTTONS_ORIGINAL)
   uint8_t version = 6;  // 41x41px
-  QRCode qrcode;
-  uint8_t qrcodeData[qrcode_getBufferSize(version)];
-  qrcode_initText(&qrcode, qrcodeData, version, ECC_HIGH, contents.c_str());
 
   u8g2.setFont(u8g2_font_courR12_tr);
 
@@ -1216,16 +1762,7 @@ void Display::draw_web_config() {
 
   uint16_t qr_x = 23;
   uint16_t qr_y = 35;
-
-  for (uint8_t y2 = 0; y2 < qrcode.size; y2++) {
-    // Each horizontal module
-    for (uint8_t x2 = 0; x2 < qrcode.size; x2++) {
-      // Display each module
-      if (qrcode_getModule(&qrcode, x2, y2)) {
-        disp->drawRect(qr_x + x2 * 2, qr_y + y2 * 2, 2, 2, GxEPD_BLACK);
-      }
-    }
-  }
+  draw_qr(qr_x, qr_y, contents.c_str(), version, 2);
   text = "--------- or ---------";
   u8g2.setFont(u8g2_font_helvB12_tr);
   w = u8g2.getUTF8Width(text);
@@ -1246,24 +1783,13 @@ void Display::draw_web_config() {
 
 #elif defined(HOME_BUTTONS_MINI)
   uint8_t version = 8;  // 49x49px
-  QRCode qrcode;
-  uint8_t qrcodeData[qrcode_getBufferSize(version)];
-  qrcode_initText(&qrcode, qrcodeData, version, ECC_HIGH, contents.c_str());
   uint16_t qr_x = 2;
   uint16_t qr_y = 2;
-  for (uint8_t y2 = 0; y2 < qrcode.size; y2++) {
-    // Each horizontal module
-    for (uint8_t x2 = 0; x2 < qrcode.size; x2++) {
-      // Display each module
-      if (qrcode_getModule(&qrcode, x2, y2)) {
-        disp->fillRect(qr_x + x2 * 4, qr_y + y2 * 4, 4, 4, GxEPD_BLACK);
-      }
-    }
-  }
-  disp->fillRect(66, 66, 68, 68, GxEPD_WHITE);
-  disp->drawXBitmap(68, 68, account_cog_64x64, 64, 64, GxEPD_BLACK);
+  draw_qr(qr_x, qr_y, contents.c_str(), version, 4);
+  gfx->fillRect(66, 66, 68, 68, GxEPD_WHITE);
+  blit(68, 68, account_cog_64x64_packed, 64, 64);
 
-  disp->fillRect(34, 186, 132, 14, GxEPD_WHITE);
+  gfx->fillRect(34, 186, 132, 14, GxEPD_WHITE);
   u8g2.setFont(u8g2_font_profont17_tr);
   const char *text = device_state_.ip();
   uint16_t w = u8g2.getUTF8Width(text);
@@ -1272,9 +1798,6 @@ void Display::draw_web_config() {
 
 #elif defined(HOME_BUTTONS_PRO)
   uint8_t version = 6;  // 41x41px
-  QRCode qrcode;
-  uint8_t qrcodeData[qrcode_getBufferSize(version)];
-  qrcode_initText(&qrcode, qrcodeData, version, ECC_HIGH, contents.c_str());
 
   u8g2.setFont(u8g2_font_courR12_tr);
 
@@ -1286,16 +1809,7 @@ void Display::draw_web_config() {
 
   uint16_t qr_x = 23;
   uint16_t qr_y = 35;
-
-  for (uint8_t y2 = 0; y2 < qrcode.size; y2++) {
-    // Each horizontal module
-    for (uint8_t x2 = 0; x2 < qrcode.size; x2++) {
-      // Display each module
-      if (qrcode_getModule(&qrcode, x2, y2)) {
-        disp->drawRect(qr_x + x2 * 2, qr_y + y2 * 2, 2, 2, GxEPD_BLACK);
-      }
-    }
-  }
+  draw_qr(qr_x, qr_y, contents.c_str(), version, 2);
   text = "--------- or ---------";
   u8g2.setFont(u8g2_font_helvB12_tr);
   w = u8g2.getUTF8Width(text);
@@ -1314,8 +1828,6 @@ void Display::draw_web_config() {
   u8g2.setCursor(0, 260);
   u8g2.print(device_state_.ip());
 #endif
-
-  disp->display();
 }
 
 void Display::draw_test(const char *text, const char *mdi_name,
@@ -1324,28 +1836,29 @@ void Display::draw_test(const char *text, const char *mdi_name,
   fg = GxEPD_BLACK;
   bg = GxEPD_WHITE;
 
-  disp->setRotation(ROTATION);
-  disp->setFullWindow();
+  gfx->setRotation(ROTATION);
 
   u8g2.setFontMode(1);
   u8g2.setForegroundColor(fg);
   u8g2.setBackgroundColor(bg);
 
-  disp->fillScreen(bg);
+  gfx->fillScreen(bg);
 
 #if defined(HOME_BUTTONS_ORIGINAL)
-  mdi_.begin();
-  draw_mdi(mdi_name, mdi_size, WIDTH / 2 - mdi_size / 2, 50);
-  mdi_.end();
+  {
+    MDIHelper::Session mdi_session(mdi_);
+    draw_mdi(mdi_name, mdi_size, WIDTH / 2 - mdi_size / 2, 50);
+  }
 
   u8g2.setFont(u8g2_font_helvB24_te);
   uint16_t w = u8g2.getUTF8Width(text);
   u8g2.setCursor(WIDTH / 2 - w / 2, 250);
   u8g2.print(text);
 #elif defined(HOME_BUTTONS_MINI)
-  mdi_.begin();
-  draw_mdi(mdi_name, mdi_size, WIDTH / 2 - mdi_size / 2, 20);
-  mdi_.end();
+  {
+    MDIHelper::Session mdi_session(mdi_);
+    draw_mdi(mdi_name, mdi_size, WIDTH / 2 - mdi_size / 2, 20);
+  }
 
   u8g2.setFont(u8g2_font_helvB24_te);
   uint16_t w = u8g2.getUTF8Width(text);
@@ -1357,25 +1870,112 @@ void Display::draw_test(const char *text, const char *mdi_name,
   u8g2.setCursor(WIDTH / 2 - w / 2, 250);
   u8g2.print(text);
 #endif
-
-  disp->display();
 }
 
 void Display::draw_white() {
-  disp->setFullWindow();
-  disp->fillScreen(GxEPD_WHITE);
-  disp->display();
+  gfx->fillScreen(GxEPD_WHITE);
 }
 
 void Display::draw_black() {
-  disp->setFullWindow();
-  disp->fillScreen(GxEPD_BLACK);
-  disp->display();
+  gfx->fillScreen(GxEPD_BLACK);
+}
+
+const IconBitmap *Display::get_qr(const char *contents, uint8_t version,
+                                 uint8_t scale) {
+  uint32_t hash =
+      fnv1a(reinterpret_cast<const uint8_t *>(contents), strlen(contents));
+  for (auto &entry : qr_cache) {
+    if (entry.bitmap.data != nullptr && entry.hash == hash &&
+        entry.version == version && entry.scale == scale) {
+      return &entry.bitmap;
+    }
+  }
+
+  QRCode qrcode;
+  uint8_t qrcode_data[qrcode_getBufferSize(version)];
+  qrcode_initText(&qrcode, qrcode_data, version, ECC_HIGH, contents);
+  uint16_t size = qrcode.size * scale;
+  uint16_t row_len = (size + 7) / 8;
+
+  QRBitmap &entry = qr_cache[qr_cache_next];
+  qr_cache_next = (qr_cache_next + 1) % QR_CACHE_SIZE;
+  free(entry.bitmap.data);
+  entry = {};
+  uint8_t *data =
+      static_cast<uint8_t *>(calloc(IconBitmap::get_len(size, size), 1));
+  if (data == nullptr) {
+    error("failed to allocate QR bitmap");
+    return nullptr;
+  }
+  for (uint8_t y2 = 0; y2 < qrcode.size; y2++) {
+    for (uint8_t x2 = 0; x2 < qrcode.size; x2++) {
+      if (!qrcode_getModule(&qrcode, x2, y2)) continue;
+      for (uint8_t dy = 0; dy < scale; dy++) {
+        uint8_t *row = data + (y2 * scale + dy) * row_len;
+        for (uint8_t dx = 0; dx < scale; dx++) {
+          uint16_t px = x2 * scale + dx;
+          row[px / 8] |= 0x80 >> (px % 8);
+        }
+      }
+    }
+  }
+  entry.hash = hash;
+  entry.version = version;
+  entry.scale = scale;
+  entry.bitmap.width = size;
+  entry.bitmap.height = size;
+  entry.bitmap.data = data;
+  debug("QR code packed: %dx%d px", size, size);
+  return &entry.bitmap;
+}
+
+void Display::draw_qr(int16_t x, int16_t y, const char *contents,
+                      uint8_t version, uint8_t scale) {
+  const IconBitmap *qr = get_qr(contents, version, scale);
+  if (qr != nullptr) {
+    blit(x, y, qr->data, qr->width, qr->height);
+  }
+}
+
+// Draws set bits of a 1-bpp bitmap (MSB first, rows byte aligned) black,
+// the UI text color.
+// Whole bytes are merged into the canvas buffer instead of single pixels.
+void Display::blit(int16_t x, int16_t y, const uint8_t *bitmap, uint16_t w,
+                   uint16_t h) {
+#if defined(HOME_BUTTONS_PAGED_RENDERING)
+  gfx->drawBitmap(x, y, bitmap, w, h, GxEPD_BLACK);  // clipped to the band
+#else
+  static_assert(ROTATION == 0, "blit() writes the unrotated canvas buffer");
+  uint8_t *buffer = canvas->getBuffer();
+  const int16_t canvas_row_len = (WIDTH + 7) / 8;
+  const uint16_t row_len = (w + 7) / 8;
+  const uint8_t last_mask = w % 8 ? 0xFF << (8 - w % 8) : 0xFF;
+  const uint8_t shift = x & 7;
+  for (uint16_t row = 0; row < h; row++) {
+    int16_t dst_y = y + row;
+    if (dst_y < 0 || dst_y >= HEIGHT) continue;
+    uint8_t *dst = buffer + dst_y * canvas_row_len;
+    const uint8_t *src = bitmap + row * row_len;
+    for (uint16_t col = 0; col < row_len; col++) {
+      uint8_t bits = col == row_len - 1 ? src[col] & last_mask : src[col];
+      if (bits == 0) continue;
+      // set canvas bit means white, so black pixels are cleared
+      int16_t idx = (x >> 3) + col;
+      if (idx >= 0 && idx < canvas_row_len) {
+        dst[idx] &= ~(bits >> shift);
+      }
+      if (shift != 0 && idx + 1 >= 0 && idx + 1 < canvas_row_len) {
+        dst[idx + 1] &= ~static_cast<uint8_t>(bits << (8 - shift));
+      }
+    }
+  }
+#endif
 }
 
 // based on GxEPD2_Spiffs_Example.ino - drawBitmapFromSpiffs_Buffered()
-// Warning - SPIFFS.begin() must be called before this function
-bool Display::draw_bmp(File &file, int16_t x, int16_t y) {
+// Warning - the icon storage must be mounted before this function
+// If target is set, the image is decoded into it instead of the canvas.
+bool Display::draw_bmp(File &file, int16_t x, int16_t y, IconBitmap *target) {
   uint32_t startTime = millis();
   if (!file) {
     error("error opening file");
@@ -1383,7 +1983,10 @@ bool Display::draw_bmp(File &file, int16_t x, int16_t y) {
   }
   bool valid = false;  // valid format to be handled
   bool flip = true;    // bitmap is stored bottom-to-top
-  if ((x >= disp->width()) || (y >= disp->height())) return false;
+  // offsets are relative to the image start, e.g. inside an icon pack
+  uint32_t base = file.position();
+  if (target == nullptr && ((x >= gfx->width()) || (y >= gfx->height())))
+    return false;
 
   // Parse BMP header
   if (read16(file) == 0x4D42) {
@@ -1413,8 +2016,15 @@ bool Display::draw_bmp(File &file, int16_t x, int16_t y) {
       }
       uint16_t w = width;
       uint16_t h = height;
-      if ((x + w - 1) >= disp->width()) w = disp->width() - x;
-      if ((y + h - 1) >= disp->height()) h = disp->height() - y;
+      if (target != nullptr) {
+        if (w > target->width) w = target->width;
+        if (h > target->height) h = target->height;
+      } else {
+        if ((x + w - 1) >= gfx->width()) w = gfx->width() - x;
+        if ((y + h - 1) >= gfx->height()) h = gfx->height() - y;
+      }
+      uint16_t target_row_size = (w + 7) / 8;
+      if (target != nullptr) target_row_size = (target->width + 7) / 8;
       valid = true;
       uint8_t bitmask = 0xFF;
       uint8_t bitshift = 8 - depth;
@@ -1423,7 +2033,7 @@ bool Display::draw_bmp(File &file, int16_t x, int16_t y) {
       bool colored = false;
       if (depth <= 8) {
         if (depth < 8) bitmask >>= depth;
-        file.seek(imageOffset - (4 << depth));
+        file.seek(base + imageOffset - (4 << depth));
         for (uint16_t pn = 0; pn < (1 << depth); pn++) {
           blue = file.read();
           green = file.read();
@@ -1451,7 +2061,7 @@ bool Display::draw_bmp(File &file, int16_t x, int16_t y) {
         uint8_t in_byte = 0;  // for depth <= 8
         uint8_t in_bits = 0;  // for depth <= 8
         uint16_t color = GxEPD_WHITE;
-        file.seek(rowPosition);
+        file.seek(base + rowPosition);
         for (uint16_t col = 0; col < w; col++)  // for each pixel
         {
           // Time to read more pixel data?
@@ -1518,8 +2128,16 @@ bool Display::draw_bmp(File &file, int16_t x, int16_t y) {
           } else {
             color = GxEPD_BLACK;
           }
-          uint16_t yrow = y + (flip ? h - row - 1 : row);
-          disp->drawPixel(x + col, yrow, color);
+          uint16_t yrow = flip ? h - row - 1 : row;
+          if (target != nullptr) {
+            if (color != GxEPD_WHITE) {
+              target->data[yrow * target_row_size + col / 8] |=
+                  0x80 >> (col % 8);
+            }
+          } else {
+            gfx->drawPixel(x + col, y + yrow,
+                              color == GxEPD_WHITE ? GxEPD_WHITE : GxEPD_BLACK);
+          }
         }  // end pixel
       }  // end line
     }
@@ -1533,11 +2151,41 @@ bool Display::draw_bmp(File &file, int16_t x, int16_t y) {
 }
 
 void Display::draw_mdi(const char *name, uint16_t size, int16_t x, int16_t y) {
+  const IconBitmap *cached = mdi_.cache().get(name, size);
+  if (cached != nullptr) {
+    gfx->drawBitmap(x, y, cached->data, cached->width, cached->height,
+                    GxEPD_BLACK, GxEPD_WHITE);
+    main_list.add_bitmap(x, y, cached->width, cached->height, cached->data,
+                         IconPack::hash(name));
+    mdi_.mark_used(name, size);
+    return;
+  }
+
+  // cache miss - icons in the glyph font are rasterized, downloaded ones
+  // require an open MDIHelper::Session
+  if (mdi_.has_glyph(name) && draw_glyph(name, size, x, y)) {
+    return;
+  }
   bool draw_placeholder = false;
-  File file;
-  if (mdi_.exists(name, size)) {
-    File file = mdi_.get_file(name, size);
-    if (!draw_bmp(file, x, y)) {
+  File file = mdi_.get_file(name, size);
+  if (file) {
+    IconBitmap *bitmap = mdi_.cache().insert(name, size, size, size);
+    bool ok;
+    if (bitmap != nullptr) {
+      ok = draw_bmp(file, x, y, bitmap);
+      if (ok) {
+        gfx->drawBitmap(x, y, bitmap->data, bitmap->width, bitmap->height,
+                        GxEPD_BLACK, GxEPD_WHITE);
+        main_list.add_bitmap(x, y, bitmap->width, bitmap->height,
+                             bitmap->data, IconPack::hash(name));
+      }
+    } else {
+      ok = draw_bmp(file, x, y);
+      main_list.abort_record();  // not decoded into memory
+    }
+    if (ok) {
+      mdi_.mark_used(name, size);
+    } else {
       error("Could not draw icon: %s", name);
       // file might be corrupted - remove so it will be downloaded again
       mdi_.remove(name, size);
@@ -1548,23 +2196,50 @@ void Display::draw_mdi(const char *name, uint16_t size, int16_t x, int16_t y) {
     draw_placeholder = true;
   }
   if (draw_placeholder) {
+    main_list.abort_record();  // compiled again once the icon is there
     if (size == 64) {
-      disp->drawXBitmap(x, y, file_question_outline_64x64, 64, 64, text_color);
+      blit(x, y, file_question_outline_64x64_packed, 64, 64);
     } else if (size == 48) {
-      disp->drawXBitmap(x, y, file_question_outline_48x48, 48, 48, text_color);
+      blit(x, y, file_question_outline_48x48_packed, 48, 48);
     } else if (size == 100) {
-      disp->drawXBitmap(x, y, file_question_outline_100x100, 100, 100,
-                        text_color);
+      blit(x, y, file_question_outline_100x100_packed, 100, 100);
     } else if (size == 92) {
-      disp->drawXBitmap(x, y, file_question_outline_92x92, 92, 92, text_color);
+      blit(x, y, file_question_outline_92x92_packed, 92, 92);
     }
   }
-  // disp->drawRect(x, y, size, size, text_color);
+  // gfx->drawRect(x, y, size, size, text_color);
+}
+
+bool Display::draw_glyph(const char *name, uint16_t size, int16_t x,
+                         int16_t y) {
+  IconBitmap *bitmap = mdi_.cache().insert(name, size, size, size);
+  IconBitmap uncached;
+  if (bitmap == nullptr) {
+    // larger than the cache budget
+    uncached.width = uncached.height = size;
+    uncached.data = static_cast<uint8_t *>(calloc(1, uncached.len()));
+    if (uncached.data == nullptr) {
+      error("Failed to allocate icon: %s", name);
+      return false;
+    }
+    bitmap = &uncached;
+  }
+  bool ok = mdi_.render_glyph(name, *bitmap);
+  if (ok) {
+    gfx->drawBitmap(x, y, bitmap->data, bitmap->width, bitmap->height,
+                    GxEPD_BLACK, GxEPD_WHITE);
+    main_list.add_bitmap(x, y, bitmap->width, bitmap->height, bitmap->data);
+  } else if (bitmap != &uncached) {
+    mdi_.cache().invalidate(name, size);
+  }
+  free(uncached.data);
+  return ok;
 }
 
 void ButtonTile::draw(Display &display, int16_t x, int16_t y, uint16_t color) {
-  // display.disp->drawRect(x, y, width, height, color);
-  switch (label_type) {
+  // display.gfx->drawRect(x, y, width, height, color);
+  const LabelLayout &layout = display.get_layout(index);
+  switch (layout.type) {
     case LabelType::Icon: {
       uint16_t mdi_size = 92;
       if (width < mdi_size || height < mdi_size) {
@@ -1573,9 +2248,7 @@ void ButtonTile::draw(Display &display, int16_t x, int16_t y, uint16_t color) {
       }
       int16_t icon_x = x + (width - mdi_size) / 2;
       int16_t icon_y = y + (height - mdi_size) / 2;
-      display.mdi_.begin();
-      display.draw_mdi(mdi_name.c_str(), mdi_size, icon_x, icon_y);
-      display.mdi_.end();
+      display.draw_mdi(layout.icon.c_str(), mdi_size, icon_x, icon_y);
       break;
     }
     case LabelType::Mixed: {
@@ -1593,30 +2266,22 @@ void ButtonTile::draw(Display &display, int16_t x, int16_t y, uint16_t color) {
       }
       int16_t icon_x = x + (width - mdi_size) / 2;
       int16_t icon_y = y + v_padding;
-      display.mdi_.begin();
-      display.draw_mdi(mdi_name.c_str(), mdi_size, icon_x, icon_y);
-      display.mdi_.end();
-
-      text = display.trim_text(text, width - 2 * h_padding);
-      uint16_t text_width = display.u8g2.getUTF8Width(text.c_str());
-      display.u8g2.setCursor(x + width / 2 - text_width / 2,
-                             y + height - v_padding + descent);
-      display.u8g2.print(text.c_str());
+      display.draw_mdi(layout.icon.c_str(), mdi_size, icon_x, icon_y);
+
+      const LabelLayout &fitted =
+          display.fit_label(index, width - 2 * h_padding, false, false);
+      display.draw_text(fitted.font, x + width / 2 - fitted.width / 2,
+                        y + height - v_padding + descent,
+                        fitted.fitted.c_str());
       break;
     }
     case LabelType::Text: {
       uint16_t h_padding = 4;
-      display.u8g2.setFont(u8g2_font_helvB24_te);
-      uint16_t text_width = display.u8g2.getUTF8Width(text.c_str());
-      if (text_width >= width - 2 * h_padding) {
-        display.u8g2.setFont(u8g2_font_helvB18_te);
-        text = display.trim_text(text, width - 2 * h_padding);
-      }
-      text_width = display.u8g2.getUTF8Width(text.c_str());
+      const LabelLayout &fitted =
+          display.fit_label(index, width - 2 * h_padding, true, false);
       int8_t ascent = display.u8g2.getFontAscent();
-      display.u8g2.setCursor(x + width / 2 - text_width / 2,
-                             y + height / 2 + ascent / 2);
-      display.u8g2.print(text.c_str());
+      display.draw_text(fitted.font, x + width / 2 - fitted.width / 2,
+                        y + height / 2 + ascent / 2, fitted.fitted.c_str());
       break;
     }
     default:
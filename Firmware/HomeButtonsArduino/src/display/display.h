@@ -1,10 +1,15 @@
 #ifndef HOMEBUTTONS_DISPLAY_H
 #define HOMEBUTTONS_DISPLAY_H
 
+#include <Adafruit_GFX.h>
 #include <GxEPD2.h>
 #include <GxEPD2_BW.h>
 #include <U8g2_for_Adafruit_GFX.h>
 
+#include <utility>
+
+#include "config.h"
+#include "display_list.h"
 #include "static_string.h"
 #include "state.h"
 #include "logger.h"
@@ -30,11 +35,92 @@ class DeviceState;
 #define GxEPD2_DRIVER_CLASS GxEPD2_420_GDEY042T91
 #endif
 
-#define MAX_DISPLAY_BUFFER_SIZE 65536ul  // e.g.
-#define MAX_HEIGHT(EPD)                                      \
-  (EPD::HEIGHT <= MAX_DISPLAY_BUFFER_SIZE / (EPD::WIDTH / 8) \
-       ? EPD::HEIGHT                                         \
-       : MAX_DISPLAY_BUFFER_SIZE / (EPD::WIDTH / 8))
+// Panel driver with timing of the framebuffer transfer and refresh phases.
+// GxEPD2_BW calls the driver through its template type, so hiding the
+// methods is enough to intercept them.
+template <typename Driver>
+class TimedDriver : public Driver {
+ public:
+  using Driver::Driver;
+
+  template <typename... Args>
+  void writeImage(Args&&... args) {
+    uint32_t start = micros();
+    Driver::writeImage(std::forward<Args>(args)...);
+    transfer_us_ += micros() - start;
+  }
+  template <typename... Args>
+  void writeImageForFullRefresh(Args&&... args) {
+    uint32_t start = micros();
+    Driver::writeImageForFullRefresh(std::forward<Args>(args)...);
+    transfer_us_ += micros() - start;
+  }
+  template <typename... Args>
+  void writeImageAgain(Args&&... args) {
+    uint32_t start = micros();
+    Driver::writeImageAgain(std::forward<Args>(args)...);
+    transfer_us_ += micros() - start;
+  }
+  template <typename... Args>
+  void writeImagePart(Args&&... args) {
+    uint32_t start = micros();
+    Driver::writeImagePart(std::forward<Args>(args)...);
+    transfer_us_ += micros() - start;
+  }
+  template <typename... Args>
+  void writeImagePartAgain(Args&&... args) {
+    uint32_t start = micros();
+    Driver::writeImagePartAgain(std::forward<Args>(args)...);
+    transfer_us_ += micros() - start;
+  }
+  template <typename... Args>
+  void refresh(Args&&... args) {
+    uint32_t start = micros();
+    Driver::refresh(std::forward<Args>(args)...);
+    refresh_us_ += micros() - start;
+  }
+
+  uint32_t transfer_us() const { return transfer_us_; }
+  uint32_t refresh_us() const { return refresh_us_; }
+  void reset_timing() { transfer_us_ = refresh_us_ = 0; }
+
+ private:
+  uint32_t transfer_us_ = 0;
+  uint32_t refresh_us_ = 0;
+};
+
+using EPDDriver = TimedDriver<GxEPD2_DRIVER_CLASS>;
+
+// With HOME_BUTTONS_PAGED_RENDERING there is no full-frame canvas, pages are
+// drawn directly into a band buffer of DISPLAY_PAGE_HEIGHT rows, once per
+// band. Saves the canvas and most of the panel buffer, drawing takes longer
+// since every band draws the page again.
+//
+// Otherwise pages are composed into a full-frame canvas and copied into a
+// frame buffer of the same size that is transferred to the controller, so
+// the next page can be composed during a refresh. That is twice the frame
+// size (Pro: 2 x 15000 bytes), the GxEPD2 buffer is not used.
+#if defined(HOME_BUTTONS_PAGED_RENDERING)
+#define PANEL_BUFFER_HEIGHT(EPD) DISPLAY_PAGE_HEIGHT
+#else
+#define PANEL_BUFFER_HEIGHT(EPD) 1
+#endif
+
+// Parsed button label and the text fitted to its area. Recomputed only when
+// the label or the fitting parameters change.
+struct LabelLayout {
+  ButtonLabel label{};
+  LabelType type = LabelType::None;
+  MDIName icon{};
+  ButtonLabel text{};
+
+  uint16_t max_width = 0;
+  bool allow_large = false;
+  bool strict = false;
+  const uint8_t* font = nullptr;
+  ButtonLabel fitted{};
+  uint16_t width = 0;
+};
 
 class Display : public Logger {
   friend class ButtonTile;
@@ -46,6 +132,10 @@ class Display : public Logger {
   void begin(HardwareDefinition& HW);
   void end();
   void update();
+  // update() without waiting for DISPLAY_CMD_SETTLE_TIME, draws the pending
+  // command now. For single draws outside the display task (setup, factory
+  // test), update() right after a command would only wait for the settle.
+  void flush_cmd();
 
   void disp_message(const char* message, uint32_t duration = 0);
   void disp_message_large(const char* message, uint32_t duration = 0);
@@ -58,31 +148,88 @@ class Display : public Logger {
   void disp_ap_config();
   void disp_web_config();
   void disp_test(const char* text, const char* mdi_name, uint16_t mdi_size);
+  // Icons changed on the server were replaced, decoded icons and the main
+  // page display list are dropped before the next main page.
+  void invalidate_icons() { icons_invalid = true; }
 
   UIState get_ui_state();
   void init_ui_state(UIState ui_state);  // used after wakeup
   State get_state();
-  bool busy() { return redraw_in_progress; }
+  // true until all issued commands are drawn and the panel is idle
+  bool busy();
+  // blocks the calling task until not busy(), returns false on timeout
+  bool wait_idle(uint32_t timeout = DISPLAY_IDLE_TIMEOUT);
+  // number of commands issued vs. refreshes executed
+  uint32_t get_cmd_count() { return cmd_seq; }
+  uint32_t get_refresh_count() { return refresh_count; }
 
  private:
   State state = State::IDLE;
 
   UIState current_ui_state = {};
-  UIState cmd_ui_state = {};
   UIState draw_ui_state = {};
   UIState pre_disappear_ui_state = {};
 
-  bool new_ui_cmd = false;
   bool redraw_in_progress = false;
 
+  // Pending UI commands. A new persistent page supersedes all pending
+  // persistent pages (e.g. consecutive main page redraws merge), only
+  // disappearing messages are kept in order. Commands are executed once no
+  // new command arrived for DISPLAY_CMD_SETTLE_TIME.
+  struct UICmd {
+    UIState ui_state;
+    uint32_t seq;
+  };
+  static constexpr uint8_t CMD_QUEUE_SIZE = 4;
+  UICmd cmd_queue[CMD_QUEUE_SIZE] = {};
+  uint8_t cmd_queue_len = 0;
+  uint32_t last_cmd_time = 0;
+  bool cmd_flush = false;  // skip the settle time, see flush_cmd()
+  portMUX_TYPE cmd_mux = portMUX_INITIALIZER_UNLOCKED;
+  uint32_t cmd_seq = 0;    // incremented on every command
+  uint32_t drawn_seq = 0;  // last command drawn to the panel
+  uint32_t refresh_count = 0;
+
+  // values on the info page, as last drawn, kept up to date with partial
+  // refreshes while the page is shown
+  enum InfoValue : uint8_t { INFO_TEMP, INFO_HUMD, INFO_BATT };
+#if defined(HOME_BUTTONS_PRO)
+  static constexpr uint8_t NUM_INFO_VALUES = 2;  // no battery
+#else
+  static constexpr uint8_t NUM_INFO_VALUES = 3;
+#endif
+  UIState::MessageType info_values[NUM_INFO_VALUES];
+  uint32_t last_info_check = 0;
+  uint8_t partial_count = 0;  // partial refreshes since the last full one
+
+  // next frame composed during the refresh of the current one
+  UIState ahead_ui_state = {};
+  uint32_t ahead_seq = 0;
+  bool ahead_ready = false;
+  bool presenting = false;
+  volatile bool refresh_started = false;  // until BUSY is seen low
+
+  int16_t busy_pin = -1;
+  TaskHandle_t busy_wait_task = nullptr;
+
   uint16_t text_color = GxEPD_BLACK;
   uint16_t bg_color = GxEPD_WHITE;
 
   const DeviceState& device_state_;
   MDIHelper& mdi_;
 
-  GxEPD2_DISPLAY_CLASS<GxEPD2_DRIVER_CLASS, MAX_HEIGHT(GxEPD2_DRIVER_CLASS)>*
-      disp;
+  GxEPD2_DISPLAY_CLASS<EPDDriver, PANEL_BUFFER_HEIGHT(EPDDriver)>* disp =
+      nullptr;
+  bool panel_ready = false;  // initialized since begin()
+  Adafruit_GFX* gfx = nullptr;  // draw target, canvas or band buffer
+#if defined(HOME_BUTTONS_PAGED_RENDERING)
+  UIState paged_ui_state = {};  // replayed for every band
+#else
+  // pages are composed here, frame only holds the frame being transferred /
+  // refreshed
+  GFXcanvas1* canvas = nullptr;
+  uint8_t* frame = nullptr;
+#endif
   U8G2_FOR_ADAFRUIT_GFX u8g2;
 
   // ### buffers for draw_bmp()
@@ -97,17 +244,74 @@ class Display : public Logger {
   uint16_t rgb_palette_buffer[max_palette_pixels];
 
   LabelType get_label_type(ButtonLabel label);
-  MDIName get_mdi_name(ButtonLabel label);
-  ButtonLabel get_text(ButtonLabel label);
 
-  ButtonLabel trim_text(ButtonLabel label, uint16_t max_width);
+  ButtonLabel trim_text(ButtonLabel label, uint16_t max_width,
+                        bool strict = false);
+
+  // QR codes packed at their drawing scale, payloads rarely change
+  struct QRBitmap {
+    uint32_t hash = 0;
+    uint8_t version = 0;
+    uint8_t scale = 0;
+    IconBitmap bitmap{};
+  };
+  static constexpr uint8_t QR_CACHE_SIZE = 3;
+  QRBitmap qr_cache[QR_CACHE_SIZE];
+  uint8_t qr_cache_next = 0;
+  const IconBitmap* get_qr(const char* contents, uint8_t version,
+                           uint8_t scale);
+
+  DisplayList main_list;  // until the key changes or icons are replaced
+  volatile bool icons_invalid = false;
+  uint32_t main_list_key();
+  bool load_main_list(uint32_t key);
+  void replay_main_list();
+
+  LabelLayout label_layouts[NUM_BUTTONS];
+  LabelLayout& get_layout(uint8_t idx);
+  const LabelLayout& fit_label(uint8_t idx, uint16_t max_width,
+                               bool allow_large, bool strict);
 
   void set_cmd_state(UIState cmd);
+  bool cmd_pending() { return cmd_queue_len > 0; }
+  bool pop_cmd(UIState& ui_state, uint32_t& seq,
+               bool allow_disappearing = true);
+  struct Area {
+    int16_t x;
+    int16_t y;
+    uint16_t w;
+    uint16_t h;
+  };
+
+  void compose(const UIState& ui_state);
+  void draw_page(const UIState& ui_state);
+#if defined(HOME_BUTTONS_PAGED_RENDERING)
+  void render_pages();
+#else
+  // pre-rendered frames of static pages, kept in flash
+  uint32_t frame_key(DisplayPage page);
+  bool load_frame(DisplayPage page, uint32_t key);
+  void save_frame(DisplayPage page, uint32_t key);
+#endif
+  void init_panel();
+  void present();
+  void present_window(const Area& area);
+  void compose_ahead();
+  void hibernate();
+
+  // refresh completion is signalled by the BUSY pin interrupt, the
+  // refreshing task blocks on a notification instead of polling the pin
+  static void busy_isr(void* arg);
+  static void busy_callback(const void* arg);
 
   void draw_message(const UIState::MessageType& message, bool error = false,
                     bool large = false);
   void draw_main();
+  void draw_buttons();
   void draw_info();
+  UIState::MessageType format_info_value(InfoValue idx);
+  void draw_info_value(InfoValue idx, Area* area = nullptr);
+  bool update_info_values();
   void draw_device_info();
   void draw_welcome();
   void draw_settings();
@@ -116,14 +320,19 @@ class Display : public Logger {
   void draw_test(const char* text, const char* mdi_name, uint16_t mdi_size);
   void draw_white();
   void draw_black();
-  bool draw_bmp(File& file, int16_t x, int16_t y);
+  void draw_qr(int16_t x, int16_t y, const char* contents, uint8_t version,
+               uint8_t scale);
+  void blit(int16_t x, int16_t y, const uint8_t* bitmap, uint16_t w,
+            uint16_t h);
+  bool draw_bmp(File& file, int16_t x, int16_t y,
+                IconBitmap* target = nullptr);
   void draw_mdi(const char* name, uint16_t size, int16_t x, int16_t y);
+  bool draw_glyph(const char* name, uint16_t size, int16_t x, int16_t y);
+  void draw_text(const uint8_t* font, int16_t x, int16_t y, const char* text);
 };
 
 struct ButtonTile {
-  LabelType label_type = LabelType::None;
-  ButtonLabel text{};
-  MDIName mdi_name{};
+  uint8_t index = 0;
   uint16_t width = 0;
   uint16_t height = 0;
 
@@ -0,0 +1,124 @@
+#include "display_list.h"
+
+static constexpr uint32_t MAGIC = 0x32444248;  // "HBD2"
+
+void DisplayList::begin_record(uint32_t key) {
+  clear();
+  key_ = key;
+  recording_ = true;
+}
+
+void DisplayList::add_bitmap(int16_t x, int16_t y, uint16_t w, uint16_t h,
+                             const uint8_t* data, uint32_t icon) {
+  if (!recording_) return;
+  if (num_ops_ >= MAX_OPS) {
+    abort_record();
+    return;
+  }
+  Op& op = ops_[num_ops_];
+  op = {OP_BITMAP, 0, x, y, w, h, static_cast<uint32_t>(data_len_), icon};
+  if (_append(data, static_cast<size_t>((w + 7) / 8) * h)) {
+    num_ops_++;
+  }
+}
+
+void DisplayList::add_text(int16_t x, int16_t y, uint8_t font,
+                           const char* text) {
+  if (!recording_) return;
+  if (num_ops_ >= MAX_OPS) {
+    abort_record();
+    return;
+  }
+  uint16_t len = strlen(text);
+  Op& op = ops_[num_ops_];
+  op = {OP_TEXT, font, x, y, len, 0, static_cast<uint32_t>(data_len_), 0};
+  if (_append(reinterpret_cast<const uint8_t*>(text), len)) {
+    num_ops_++;
+  }
+}
+
+void DisplayList::abort_record() {
+  if (!recording_) return;
+  debug("recording aborted");
+  clear();
+}
+
+bool DisplayList::end_record() {
+  if (!recording_) return false;
+  recording_ = false;
+  valid_ = true;
+  debug("recorded %u ops, %u bytes", num_ops_, data_len_);
+  return true;
+}
+
+bool DisplayList::load(File& file, uint32_t key) {
+  if (valid(key)) return true;
+  clear();
+  Header header;
+  if (file.read(reinterpret_cast<uint8_t*>(&header), sizeof(header)) !=
+          sizeof(header) ||
+      header.magic != MAGIC || header.num_ops > MAX_OPS) {
+    warning("invalid file");
+    return false;
+  }
+  if (header.key != key) {
+    debug("outdated, key %08x", header.key);
+    return false;
+  }
+  size_t ops_len = header.num_ops * sizeof(Op);
+  data_ = static_cast<uint8_t*>(malloc(header.data_len));
+  if (data_ == nullptr && header.data_len > 0) {
+    error("failed to allocate %u bytes", header.data_len);
+    return false;
+  }
+  if (file.read(reinterpret_cast<uint8_t*>(ops_), ops_len) != ops_len ||
+      file.read(data_, header.data_len) != header.data_len) {
+    warning("truncated file");
+    clear();
+    return false;
+  }
+  key_ = key;
+  num_ops_ = header.num_ops;
+  data_len_ = header.data_len;
+  valid_ = true;
+  return true;
+}
+
+bool DisplayList::save(File& file) {
+  if (!valid_) return false;
+  Header header = {MAGIC, key_, static_cast<uint32_t>(data_len_), num_ops_};
+  size_t ops_len = num_ops_ * sizeof(Op);
+  if (file.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header)) !=
+          sizeof(header) ||
+      file.write(reinterpret_cast<const uint8_t*>(ops_), ops_len) !=
+          ops_len ||
+      file.write(data_, data_len_) != data_len_) {
+    error("write failed");
+    return false;
+  }
+  info("saved %u ops, %u bytes", num_ops_, sizeof(header) + ops_len +
+                                               data_len_);
+  return true;
+}
+
+void DisplayList::clear() {
+  free(data_);
+  data_ = nullptr;
+  data_len_ = 0;
+  num_ops_ = 0;
+  valid_ = false;
+  recording_ = false;
+}
+
+bool DisplayList::_append(const uint8_t* data, size_t len) {
+  uint8_t* grown = static_cast<uint8_t*>(realloc(data_, data_len_ + len));
+  if (grown == nullptr && data_len_ + len > 0) {
+    error("failed to allocate %u bytes", data_len_ + len);
+    abort_record();
+    return false;
+  }
+  data_ = grown;
+  memcpy(data_ + data_len_, data, len);
+  data_len_ += len;
+  return true;
+}
@@ -0,0 +1,76 @@
+#ifndef HOMEBUTTONS_DISPLAY_LIST_H
+#define HOMEBUTTONS_DISPLAY_LIST_H
+
+#include <FS.h>
+
+#include "config.h"
+#include "logger.h"
+
+// Compiled main page content: icon bitmaps with offsets into a data blob and
+// text runs with font and position. Recorded while the page is drawn and
+// stored in flash together with the bitmaps, so a redraw with the same key
+// (labels, firmware) is replayed without parsing labels, fitting text or
+// decoding icons. The list stays in memory while the key matches, flash is
+// only read after a wake.
+class DisplayList : public Logger {
+ public:
+  enum OpType : uint8_t { OP_BITMAP, OP_TEXT };
+  struct Op {
+    OpType type;
+    uint8_t font;  // OP_TEXT: index into the display font table
+    int16_t x;
+    int16_t y;
+    uint16_t w;  // OP_BITMAP: size, OP_TEXT: text length
+    uint16_t h;
+    uint32_t offset;  // into data()
+    uint32_t icon;    // OP_BITMAP: IconPack::hash() of the icon or 0
+  };
+
+  DisplayList() : Logger("DList") {}
+  DisplayList(const DisplayList&) = delete;
+  ~DisplayList() { clear(); }
+
+  // recording, ops are collected until end_record()
+  void begin_record(uint32_t key);
+  // icon: hash of a stored icon, marked as used when the list is replayed
+  void add_bitmap(int16_t x, int16_t y, uint16_t w, uint16_t h,
+                  const uint8_t* data, uint32_t icon = 0);
+  void add_text(int16_t x, int16_t y, uint8_t font, const char* text);
+  // content not reproducible (e.g. a missing icon), the list is discarded
+  void abort_record();
+  bool recording() const { return recording_; }
+  // returns true if the list is complete and valid
+  bool end_record();
+
+  // true if the list for key is in memory or was read from file
+  bool load(File& file, uint32_t key);
+  bool save(File& file);
+  bool valid(uint32_t key) const { return valid_ && key_ == key; }
+  void clear();
+
+  uint8_t size() const { return num_ops_; }
+  const Op& op(uint8_t idx) const { return ops_[idx]; }
+  const uint8_t* data() const { return data_; }
+
+ private:
+  static constexpr uint8_t MAX_OPS = 2 * NUM_BUTTONS;  // icon + text each
+
+  struct Header {
+    uint32_t magic;
+    uint32_t key;
+    uint32_t data_len;
+    uint8_t num_ops;
+  };
+
+  uint32_t key_ = 0;
+  bool valid_ = false;
+  bool recording_ = false;
+  Op ops_[MAX_OPS] = {};
+  uint8_t num_ops_ = 0;
+  uint8_t* data_ = nullptr;
+  size_t data_len_ = 0;
+
+  bool _append(const uint8_t* data, size_t len);
+};
+
+#endif  // HOMEBUTTONS_DISPLAY_LIST_H
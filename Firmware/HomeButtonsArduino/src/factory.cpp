@@ -81,18 +81,15 @@ bool FactoryTest::run_test() {
   app_._begin_hw();
 
 #if defined(HAS_DISPLAY)
-  // format SPIFFS if needed
-  if (!SPIFFS.begin()) {
+  // format icon storage if needed
+  if (!icon_storage().mountable()) {
     info("Formatting icon storage...");
     app_.display_.disp_message("Formatting\nIcon\nStorage...", 0);
-    app_.display_.update();
-    SPIFFS.format();
-  } else {
-    SPIFFS.end();
-    debug("SPIFFS test mount OK");
+    app_.display_.flush_cmd();
+    icon_storage().format();
   }
   app_.display_.disp_message_large("FACTORY");
-  app_.display_.update();
+  app_.display_.flush_cmd();
 #endif
 
   WiFiClient wifi_client;
@@ -172,7 +169,7 @@ bool FactoryTest::run_test() {
 
   app_.display_.disp_test(test_spec_.disp_text.c_str(),
                           test_spec_.mdi_name.c_str(), 100);
-  app_.display_.update();
+  app_.display_.flush_cmd();
   passed = passed && display_passed;
 #endif
 
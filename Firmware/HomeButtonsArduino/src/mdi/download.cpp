@@ -2,15 +2,246 @@
 
 #include <stdint.h>
 #include <WiFiClientSecure.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
 
 #include <HTTPClient.h>
 
 #include "config.h"
+#include "gunzip.h"
 #include "logger.h"
 #include "static_string.h"
 
 static constexpr uint32_t DOWNLOAD_TIMEOUT = 5000;
-static constexpr size_t DOWNLOAD_BUFFER_SIZE = 1024;
+static constexpr uint32_t WRITER_STACK_SIZE = 4096;  // bytes, inflater included
+
+namespace download {
+// Writes a response body to a file, through the inflater for gzip. Without
+// overlap each chunk is written before the next one is received. With
+// overlap a writer task writes one buffer while the next chunk is received
+// into the other.
+class Writer {
+ public:
+  Writer(size_t buffer_size, bool overlap);
+  ~Writer();
+  Writer(const Writer&) = delete;
+  Writer& operator=(const Writer&) = delete;
+
+  size_t buffer_size() const { return buffer_size_; }
+  void begin(File& file);
+  // chunks from now on are inflated, gunzip has begun on the same file
+  void inflate(Gunzip* gunzip) { gunzip_ = gunzip; }
+  // buffer to receive the next chunk into, nullptr if out of memory
+  uint8_t* buffer();
+  // writes len bytes of the buffer from buffer(), false if a write failed
+  bool write(size_t len);
+  // waits for pending writes, false if one failed
+  bool finish();
+  // input bytes written since begin()
+  uint32_t bytes() const { return bytes_; }
+  uint32_t write_us() const { return write_us_; }
+
+ private:
+  struct Chunk {
+    uint8_t* data;
+    size_t len;
+  };
+
+  Logger logger_;
+  size_t buffer_size_;
+  bool overlap_;
+  uint8_t* buffers_[2] = {};
+  uint8_t* held_ = nullptr;
+  QueueHandle_t filled_ = nullptr;
+  QueueHandle_t free_ = nullptr;
+  TaskHandle_t task_h_ = nullptr;
+  File* file_ = nullptr;
+  Gunzip* gunzip_ = nullptr;
+  volatile bool failed_ = false;
+  volatile uint32_t bytes_ = 0;
+  volatile uint32_t write_us_ = 0;
+
+  static void _task(void* param);
+  void _write(const Chunk& chunk);
+};
+}  // namespace download
+
+download::Writer::Writer(size_t buffer_size, bool overlap)
+    : logger_("Writer"), buffer_size_(buffer_size), overlap_(overlap) {
+  buffers_[0] = static_cast<uint8_t*>(malloc(buffer_size_));
+  if (!overlap_) {
+    return;
+  }
+  buffers_[1] = static_cast<uint8_t*>(malloc(buffer_size_));
+  filled_ = xQueueCreate(2, sizeof(Chunk));
+  free_ = xQueueCreate(2, sizeof(uint8_t*));
+  if (buffers_[1] == nullptr || filled_ == nullptr || free_ == nullptr ||
+      xTaskCreate(_task, "WRITER", WRITER_STACK_SIZE, this,
+                  uxTaskPriorityGet(nullptr), &task_h_) != pdPASS) {
+    logger_.warning("no writer task, writes don't overlap");
+    overlap_ = false;
+    return;
+  }
+  for (uint8_t* buffer : buffers_) {
+    xQueueSend(free_, &buffer, 0);
+  }
+}
+
+download::Writer::~Writer() {
+  if (task_h_ != nullptr) {
+    finish();
+    // waiting for the next chunk
+    vTaskDelete(task_h_);
+  }
+  if (filled_ != nullptr) vQueueDelete(filled_);
+  if (free_ != nullptr) vQueueDelete(free_);
+  for (uint8_t* buffer : buffers_) {
+    free(buffer);
+  }
+}
+
+void download::Writer::begin(File& file) {
+  file_ = &file;
+  gunzip_ = nullptr;
+  failed_ = false;
+  bytes_ = 0;
+}
+
+uint8_t* download::Writer::buffer() {
+  if (!overlap_) {
+    return buffers_[0];
+  }
+  if (held_ == nullptr) {
+    xQueueReceive(free_, &held_, portMAX_DELAY);
+  }
+  return held_;
+}
+
+bool download::Writer::write(size_t len) {
+  if (!overlap_) {
+    _write({buffers_[0], len});
+    return !failed_;
+  }
+  Chunk chunk = {held_, len};
+  held_ = nullptr;
+  xQueueSend(filled_, &chunk, portMAX_DELAY);
+  return !failed_;
+}
+
+bool download::Writer::finish() {
+  if (overlap_) {
+    // all buffers back means all chunks are written
+    if (held_ != nullptr) {
+      xQueueSend(free_, &held_, portMAX_DELAY);
+      held_ = nullptr;
+    }
+    uint8_t* buffers[2];
+    for (uint8_t*& buffer : buffers) {
+      xQueueReceive(free_, &buffer, portMAX_DELAY);
+    }
+    for (uint8_t* buffer : buffers) {
+      xQueueSend(free_, &buffer, 0);
+    }
+  }
+  return !failed_;
+}
+
+void download::Writer::_task(void* param) {
+  Writer* writer = static_cast<Writer*>(param);
+  Chunk chunk;
+  while (true) {
+    if (xQueueReceive(writer->filled_, &chunk, portMAX_DELAY) == pdTRUE) {
+      writer->_write(chunk);
+      xQueueSend(writer->free_, &chunk.data, portMAX_DELAY);
+    }
+  }
+}
+
+void download::Writer::_write(const Chunk& chunk) {
+  if (failed_) {
+    return;
+  }
+  uint32_t start = micros();
+  if (gunzip_ != nullptr) {
+    failed_ = !gunzip_->write(chunk.data, chunk.len);
+  } else if (file_->write(chunk.data, chunk.len) != chunk.len) {
+    logger_.error("Write failed");
+    failed_ = true;
+  }
+  write_us_ += micros() - start;
+  if (!failed_) {
+    bytes_ += chunk.len;
+  }
+}
+
+struct Body {
+  int received = 0;
+  bool complete = false;
+  bool inflated = false;
+};
+
+// Writes the response body to file, reads exactly the announced length so
+// the connection can be reused. A gzip body is decompressed with gunzip if
+// given. On a timeout or a lost connection the bytes received so far stay
+// in the file.
+static Body read_body(HTTPClient& https, File& file, download::Writer& writer,
+                      Logger& logger, Gunzip* gunzip = nullptr) {
+  WiFiClient* stream = https.getStreamPtr();
+  Body body;
+  bool failed = false;
+  int queued = 0;
+  uint32_t start_time = millis();
+  writer.begin(file);
+  while (!failed && https.connected() && queued < https.getSize()) {
+    if (millis() - start_time > DOWNLOAD_TIMEOUT) {
+      logger.error("Download timed out after %d of %d bytes", queued,
+                   https.getSize());
+      failed = true;
+      break;
+    }
+    if (!stream->available()) {
+      delay(1);
+      continue;
+    }
+    uint8_t* buffer = writer.buffer();
+    if (buffer == nullptr) {
+      logger.error("No buffer");
+      failed = true;
+      break;
+    }
+    int bytesRead = stream->readBytes(
+        buffer, std::min<int>(writer.buffer_size(), https.getSize() - queued));
+    if (bytesRead == 0) {
+      break;
+    }
+    if (queued == 0 && gunzip != nullptr &&
+        Gunzip::is_gzip(buffer, bytesRead)) {
+      if (!gunzip->begin(file)) {
+        failed = true;
+        break;
+      }
+      body.inflated = true;
+      writer.inflate(gunzip);
+    }
+    failed = !writer.write(bytesRead);
+    queued += bytesRead;
+  }
+  failed = !writer.finish() || failed;
+  // only what made it into the file counts for resuming
+  body.received = writer.bytes();
+  if (failed) {
+    return body;
+  }
+  if (body.received < https.getSize()) {
+    logger.error("Connection lost after %d of %d bytes", body.received,
+                 https.getSize());
+    return body;
+  }
+  body.complete = !body.inflated || gunzip->finish();
+  logger.debug("Received %d bytes", body.received);
+  return body;
+}
 
 bool download::download_file_https(const char* host, const char* url,
                                    File& file, const char* certificate) {
@@ -29,33 +260,12 @@ bool download::download_file_https(const char* host, const char* url,
   }
 
   // Write the BMP data to the file
-  WiFiClient* stream = https.getStreamPtr();
-  int totalBytes = 0;
-  uint32_t start_time = millis();
-  while (https.connected() && (totalBytes < https.getSize())) {
-    if (stream->available()) {
-      uint8_t buffer[DOWNLOAD_BUFFER_SIZE];
-      int bytesRead = stream->readBytes(buffer, sizeof(buffer));
-      if (bytesRead == 0) {
-        break;
-      }
-      file.write(buffer, bytesRead);
-      totalBytes += bytesRead;
-    }
-    if (millis() - start_time > DOWNLOAD_TIMEOUT) {
-      logger.error("Download timed out");
-      https.end();
-      file.close();
-      return false;
-    }
-    delay(1);
-  }
+  download::Writer writer(MDI_DOWNLOAD_BUFFER, false);
+  Body body = read_body(https, file, writer, logger);
   file.close();
-  logger.debug("Wrote %d bytes", totalBytes);
-
   https.end();
   logger.debug("Disconnected from server");
-  return true;
+  return body.complete;
 }
 
 bool download::check_connection(const char* host, const char* url,
@@ -75,4 +285,197 @@ bool download::check_connection(const char* host, const char* url,
   } else {
     return true;
   }
-}
\ No newline at end of file
+}
+
+download::Client::Client(const char* certificate, size_t buffer_size,
+                         bool overlap_writes)
+    : certificate_(certificate),
+      buffer_size_(buffer_size),
+      overlap_writes_(overlap_writes),
+      http_(new HTTPClient) {
+  static const char* HEADERS[] = {"ETag", "Last-Modified", "Content-Range"};
+  http_->setConnectTimeout(DOWNLOAD_TIMEOUT);
+  http_->setTimeout(DOWNLOAD_TIMEOUT);
+  http_->setReuse(true);
+  http_->collectHeaders(HEADERS, sizeof(HEADERS) / sizeof(HEADERS[0]));
+}
+
+download::Client::~Client() {
+  end();
+  delete http_;
+  delete gunzip_;
+  delete writer_;
+  delete secure_client_;
+  delete plain_client_;
+}
+
+WiFiClient* download::Client::_client(const char* url) {
+  // one host per batch, the scheme of the first URL decides
+  if (secure_client_ != nullptr) return secure_client_;
+  if (plain_client_ != nullptr) return plain_client_;
+  if (strncmp(url, "https:", 6) == 0) {
+    secure_client_ = new WiFiClientSecure;
+    if (certificate_ != nullptr) {
+      secure_client_->setCACert(certificate_);
+    } else {
+      secure_client_->setInsecure();
+    }
+    return secure_client_;
+  }
+  plain_client_ = new WiFiClient;
+  return plain_client_;
+}
+
+// Connects before HTTPClient does, which reuses the connection, to tell the
+// TCP connect and TLS handshake apart from the request.
+bool download::Client::_connect(const char* url) {
+  static Logger logger("Download");
+
+  bool secure = strncmp(url, "https://", 8) == 0;
+  const char* host = url + (secure ? 8 : 7);
+  size_t host_len = strcspn(host, ":/");
+  StaticString<ICON_URL_MAXLEN> host_name("%.*s", host_len, host);
+  uint16_t port = host[host_len] == ':' ? atoi(host + host_len + 1)
+                  : secure              ? 443
+                                        : 80;
+  uint32_t start = millis();
+  int ret = secure_client_ != nullptr
+                ? secure_client_->connect(host_name.c_str(), port,
+                                          DOWNLOAD_TIMEOUT)
+                : plain_client_->connect(host_name.c_str(), port,
+                                         DOWNLOAD_TIMEOUT);
+  if (!ret) {
+    logger.error("Failed to connect to %s:%u", host_name.c_str(), port);
+    return false;
+  }
+  uint32_t elapsed = millis() - start;
+  connects_++;
+  connect_ms_ += elapsed;
+  logger.debug("Connected to %s:%u in %u ms", host_name.c_str(), port,
+               elapsed);
+  return true;
+}
+
+uint32_t download::Client::write_us() const {
+  return writer_ != nullptr ? writer_->write_us() : 0;
+}
+
+download::Validator download::Client::_response_validator() {
+  Validator validator;
+  if (http_->hasHeader("ETag")) {
+    validator.kind = Validator::ETAG;
+    validator.value = http_->header("ETag").c_str();
+  } else if (http_->hasHeader("Last-Modified")) {
+    validator.kind = Validator::LAST_MODIFIED;
+    validator.value = http_->header("Last-Modified").c_str();
+  }
+  return validator;
+}
+
+bool download::Client::get(const char* url, File& file, Request* request) {
+  static Logger logger("Download");
+
+  uint32_t start = millis();
+  requests_++;
+  WiFiClient* client = _client(url);
+  bool connected = client->connected() || _connect(url);
+  http_->begin(*client, url);
+  uint32_t offset = 0;
+  if (request != nullptr) {
+    const Validator& validator = request->validator;
+    request->not_modified = false;
+    if (request->conditional && validator.kind != Validator::NONE) {
+      http_->addHeader(validator.kind == Validator::ETAG ? "If-None-Match"
+                                                         : "If-Modified-Since",
+                       validator.value.c_str());
+    } else if (request->length > 0 && validator.strong() &&
+               request->fs != nullptr) {
+      // the server sends the whole file instead if it changed
+      offset = request->length;
+      http_->addHeader("Range", StaticString<24>("bytes=%u-", offset).c_str());
+      http_->addHeader("If-Range", validator.value.c_str());
+    }
+  }
+  status_ = connected ? http_->GET() : HTTPC_ERROR_CONNECTION_REFUSED;
+  if (gunzip_ == nullptr) {
+    gunzip_ = new Gunzip;
+  }
+  if (writer_ == nullptr) {
+    writer_ = new Writer(buffer_size_, overlap_writes_);
+  }
+  Body body;
+  bool not_modified = false;
+  uint32_t range_start = UINT32_MAX;
+  if (status_ == HTTP_CODE_PARTIAL_CONTENT) {
+    sscanf(http_->header("Content-Range").c_str(), "bytes %u-", &range_start);
+  }
+  if (status_ == HTTP_CODE_NOT_MODIFIED && request != nullptr &&
+      request->conditional) {
+    not_modified = true;
+    body.complete = true;
+  } else if (status_ == HTTP_CODE_PARTIAL_CONTENT && offset > 0 &&
+             range_start == offset) {
+    logger.debug("Resuming at %u bytes", offset);
+    // only the start of a body tells a gzip body apart
+    body = read_body(*http_, file, *writer_, logger);
+  } else if (status_ == HTTP_CODE_OK) {
+    if (offset > 0) {
+      logger.debug("Changed on the server, not resumed");
+      offset = 0;
+      // the partial download may be longer than the new file
+      StaticString<UINT8_MAX + 24> path(file.path());
+      file.close();
+      file = request->fs->open(path.c_str(), FILE_WRITE);
+      if (!file) {
+        logger.error("Failed to open '%s' for writing", path.c_str());
+      }
+    }
+    body = read_body(*http_, file, *writer_, logger, gunzip_);
+  } else {
+    logger.error("GET request failed with code %d", status_);
+  }
+  if (request != nullptr) {
+    Validator validator = _response_validator();
+    if (validator.kind != Validator::NONE || status_ == HTTP_CODE_OK) {
+      request->validator = validator;
+    }
+    request->not_modified = not_modified;
+    if (body.inflated) {
+      // an inflated partial can't be resumed, the inflater state is lost
+      request->length = body.complete ? gunzip_->out_bytes() : 0;
+    } else {
+      request->length = offset + body.received;
+    }
+  }
+  file.close();
+  // keeps the connection open if the server allows it and nothing of the
+  // response is left unread
+  http_->end();
+  if (!body.complete && client->connected()) {
+    client->stop();
+  }
+  time_ms_ += millis() - start;
+  bytes_ += body.received;
+  if (!body.complete) {
+    return false;
+  }
+  if (body.inflated) {
+    gzipped_++;
+    stored_bytes_ += gunzip_->out_bytes();
+  } else {
+    stored_bytes_ += body.received;
+  }
+  return true;
+}
+
+void download::Client::end() {
+  static Logger logger("Download");
+
+  WiFiClient* client = secure_client_ != nullptr
+                           ? static_cast<WiFiClient*>(secure_client_)
+                           : plain_client_;
+  if (client != nullptr && client->connected()) {
+    client->stop();
+    logger.debug("Disconnected from server");
+  }
+}
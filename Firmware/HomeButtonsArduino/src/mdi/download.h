@@ -3,11 +3,115 @@
 
 #include <FS.h>
 
+#include "config.h"
+#include "static_string.h"
+
+class Gunzip;
+class HTTPClient;
+class WiFiClient;
+class WiFiClientSecure;
+
 namespace download {
+class Writer;
+
 bool download_file_https(const char* host, const char* url, File& file,
                          const char* certificate);
 
 bool check_connection(const char* host, const char* url,
                       const char* certificate);
+
+// Version of a file on the server: its ETag or, if the server sends none,
+// its Last-Modified date.
+struct Validator {
+  enum Kind : uint8_t { NONE, ETAG, LAST_MODIFIED };
+  Kind kind = NONE;
+  StaticString<MDI_VALIDATOR_MAXLEN> value;
+
+  // weak ETags don't identify the bytes, a download can't be resumed with
+  // them
+  bool strong() const {
+    return kind == LAST_MODIFIED || (kind == ETAG && value[0] == '"');
+  }
+};
+
+// Options and outcome of Client::get()
+struct Request {
+  // in: of the stored copy or of the partial download, out: of the response
+  Validator validator;
+  // in: only download if changed since validator
+  bool conditional = false;
+  // in: bytes of a partial download in the file, resumed with a range
+  // request if validator still matches and fs is set. The file must be
+  // open for writing at that position.
+  // out: bytes in the file, also after a failed transfer if it can be
+  // resumed
+  uint32_t length = 0;
+  // in: file system of the file, the file is opened again on it, empty, if
+  // the server sends the whole file instead of the range
+  fs::FS* fs = nullptr;
+  // out: the stored copy is still current, the file is untouched
+  bool not_modified = false;
+};
+
+// HTTP(S) client for a batch of downloads from one host. The connection is
+// kept alive between requests, so there is one TLS handshake per batch
+// instead of one per file. https URLs are verified with certificate (not
+// verified if nullptr, for a local test server), plain http is meant for a
+// mirror on the local network. The body is received in chunks of
+// buffer_size bytes, with overlap_writes a chunk is written to flash by a
+// writer task while the next one is received.
+class Client {
+ public:
+  explicit Client(const char* certificate,
+                  size_t buffer_size = MDI_DOWNLOAD_BUFFER,
+                  bool overlap_writes = MDI_DOWNLOAD_OVERLAP);
+  ~Client();
+  Client(const Client&) = delete;
+  Client& operator=(const Client&) = delete;
+
+  // GET url into file, the file is closed afterwards. A gzip body is
+  // decompressed into the file while it is received.
+  bool get(const char* url, File& file, Request* request = nullptr);
+  // closes the connection
+  void end();
+
+  // HTTP status of the last request, negative for connection errors
+  int status() const { return status_; }
+  // connections established, 0 if the host was never reached
+  uint16_t connects() const { return connects_; }
+  // spent in TCP connects and TLS handshakes
+  uint32_t connect_ms() const { return connect_ms_; }
+  uint16_t requests() const { return requests_; }
+  uint16_t gzipped() const { return gzipped_; }
+  // received, compressed if gzipped
+  uint32_t bytes() const { return bytes_; }
+  // written to files
+  uint32_t stored_bytes() const { return stored_bytes_; }
+  uint32_t time_ms() const { return time_ms_; }
+  // spent writing to files, inflating included
+  uint32_t write_us() const;
+
+ private:
+  const char* certificate_;
+  size_t buffer_size_;
+  bool overlap_writes_;
+  WiFiClientSecure* secure_client_ = nullptr;
+  WiFiClient* plain_client_ = nullptr;
+  HTTPClient* http_;
+  Gunzip* gunzip_ = nullptr;
+  Writer* writer_ = nullptr;
+  int status_ = 0;
+  uint16_t connects_ = 0;
+  uint32_t connect_ms_ = 0;
+  uint16_t requests_ = 0;
+  uint16_t gzipped_ = 0;
+  uint32_t bytes_ = 0;
+  uint32_t stored_bytes_ = 0;
+  uint32_t time_ms_ = 0;
+
+  WiFiClient* _client(const char* url);
+  bool _connect(const char* url);
+  Validator _response_validator();
+};
 }  // namespace download
 #endif
@@ -0,0 +1,198 @@
+#include "glyph_font.h"
+
+#include <esp32s2/rom/miniz.h>
+
+#include "config.h"
+#include "icon_pack.h"
+#include "icon_storage.h"
+#include "rasterizer.h"
+
+static constexpr char PATH[] = "/glyphs.bin";
+static constexpr uint32_t MAGIC = 0x4C474248;  // "HBGL"
+static constexpr uint16_t VERSION = 1;
+
+enum Op : uint8_t { MOVE, LINE, QUAD, CUBIC };
+static constexpr uint8_t NUM_POINTS[] = {1, 1, 2, 3};
+
+bool GlyphFont::begin() {
+  if (begun_) {
+    return valid_;
+  }
+  begun_ = true;
+  if (!icon_fs().exists(PATH)) {
+    debug("no glyph font");
+    return false;
+  }
+  file_ = icon_fs().open(PATH, FILE_READ);
+  if (!file_ || !_read(0, &header_, sizeof(header_))) {
+    file_.close();
+    return false;
+  }
+  size_t tables = sizeof(Header) + header_.count * sizeof(IndexEntry) +
+                  header_.num_blocks * sizeof(Block);
+  if (header_.magic != MAGIC || header_.version != VERSION ||
+      header_.units == 0 || header_.size > file_.size() ||
+      tables > header_.size) {
+    warning("'%s' is not a glyph font", PATH);
+    file_.close();
+    return false;
+  }
+  valid_ = true;
+  info("%u icons in %u blocks", header_.count, header_.num_blocks);
+  return true;
+}
+
+void GlyphFont::end() {
+  file_.close();
+  header_ = {};
+  valid_ = false;
+  begun_ = false;
+}
+
+uint32_t GlyphFont::count() const { return valid_ ? header_.count : 0; }
+
+bool GlyphFont::contains(const char* name) {
+  IndexEntry entry;
+  return _find(name, entry);
+}
+
+bool GlyphFont::render(const char* name, IconBitmap& bitmap) {
+  IndexEntry entry;
+  if (!_find(name, entry)) {
+    return false;
+  }
+  uint32_t start = micros();
+  Block block;
+  uint32_t blocks = sizeof(Header) + header_.count * sizeof(IndexEntry);
+  if (!_read(blocks + entry.block * sizeof(Block), &block, sizeof(block))) {
+    return false;
+  }
+  uint8_t* raw = static_cast<uint8_t*>(malloc(block.length));
+  if (raw == nullptr) {
+    error("failed to allocate %u bytes", block.length);
+    return false;
+  }
+  bool ok = _inflate(block, raw) && entry.offset < block.length &&
+            _draw(raw + entry.offset, block.length - entry.offset, bitmap);
+  free(raw);
+  if (ok) {
+    debug("'%s' %ux%u rendered in %u us", name, bitmap.width, bitmap.height,
+          micros() - start);
+  } else {
+    error("failed to render '%s'", name);
+  }
+  return ok;
+}
+
+bool GlyphFont::_read(uint32_t offset, void* buf, size_t len) {
+  if (!file_.seek(offset) ||
+      file_.read(static_cast<uint8_t*>(buf), len) != len) {
+    error("read of %u bytes at %u failed", len, offset);
+    return false;
+  }
+  return true;
+}
+
+// binary search in the index, which stays in the file
+bool GlyphFont::_find(const char* name, IndexEntry& entry) {
+  if (!valid_) {
+    return false;
+  }
+  uint32_t hash = IconPack::hash(name);
+  uint32_t lo = 0;
+  uint32_t hi = header_.count;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    if (!_read(sizeof(Header) + mid * sizeof(IndexEntry), &entry,
+               sizeof(entry))) {
+      return false;
+    }
+    if (entry.hash < hash) {
+      lo = mid + 1;
+    } else if (entry.hash > hash) {
+      hi = mid;
+    } else {
+      return entry.block < header_.num_blocks;
+    }
+  }
+  return false;
+}
+
+bool GlyphFont::_inflate(const Block& block, uint8_t* out) {
+  if (block.length > MDI_GLYPH_BLOCK ||
+      block.offset + block.deflated_length > header_.size) {
+    error("invalid block at %u", block.offset);
+    return false;
+  }
+  uint8_t* in = static_cast<uint8_t*>(malloc(block.deflated_length));
+  tinfl_decompressor* inflator =
+      static_cast<tinfl_decompressor*>(malloc(sizeof(tinfl_decompressor)));
+  if (in == nullptr || inflator == nullptr) {
+    error("failed to allocate %u bytes",
+          block.deflated_length + sizeof(tinfl_decompressor));
+    free(in);
+    free(inflator);
+    return false;
+  }
+  if (!_read(block.offset, in, block.deflated_length)) {
+    free(in);
+    free(inflator);
+    return false;
+  }
+  tinfl_init(inflator);
+  size_t in_size = block.deflated_length;
+  size_t out_size = block.length;
+  tinfl_status status =
+      tinfl_decompress(inflator, in, &in_size, out, out, &out_size,
+                       TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF);
+  free(inflator);
+  free(in);
+  if (status != TINFL_STATUS_DONE || out_size != block.length) {
+    error("block at %u: inflate status %d, %u bytes", block.offset, status,
+          out_size);
+    return false;
+  }
+  return true;
+}
+
+bool GlyphFont::_draw(const uint8_t* glyph, size_t len,
+                      IconBitmap& bitmap) const {
+  if (len < 2) {
+    return false;
+  }
+  uint16_t num_ops = glyph[0] | (glyph[1] << 8);
+  const uint8_t* ops = glyph + 2;
+  const uint8_t* points = ops + (num_ops + 3) / 4;
+  const uint8_t* end = glyph + len;
+  // font units to 1/ONE pixel
+  int32_t scale_x = bitmap.width * Rasterizer::ONE;
+  int32_t scale_y = bitmap.height * Rasterizer::ONE;
+  int32_t units = header_.units;
+  auto x = [&](uint8_t i) { return points[2 * i] * scale_x / units; };
+  auto y = [&](uint8_t i) { return points[2 * i + 1] * scale_y / units; };
+
+  Rasterizer rasterizer;
+  for (uint16_t i = 0; i < num_ops; i++) {
+    Op op = static_cast<Op>((ops[i / 4] >> (2 * (i % 4))) & 0x03);
+    if (points + 2 * NUM_POINTS[op] > end) {
+      error("glyph truncated after %u of %u operations", i, num_ops);
+      return false;
+    }
+    switch (op) {
+      case MOVE:
+        rasterizer.move_to(x(0), y(0));
+        break;
+      case LINE:
+        rasterizer.line_to(x(0), y(0));
+        break;
+      case QUAD:
+        rasterizer.quad_to(x(0), y(0), x(1), y(1));
+        break;
+      case CUBIC:
+        rasterizer.cubic_to(x(0), y(0), x(1), y(1), x(2), y(2));
+        break;
+    }
+    points += 2 * NUM_POINTS[op];
+  }
+  return rasterizer.fill(bitmap);
+}
@@ -0,0 +1,67 @@
+#ifndef HOMEBUTTONS_GLYPH_FONT_H
+#define HOMEBUTTONS_GLYPH_FONT_H
+
+#include <FS.h>
+
+#include "icon_cache.h"
+#include "logger.h"
+
+// Outlines of the Material Design Icons in /glyphs.bin on the icon storage,
+// written by tools/pack_glyphs.py and flashed with the file system image.
+// Icons in the font are rasterized at any size, so they need no downloads
+// and take no space per size. Glyphs are deflated in blocks of up to
+// MDI_GLYPH_BLOCK bytes and looked up by name hash (IconPack::hash()) with a
+// binary search in the file, the packing tool rejects colliding names.
+class GlyphFont : public Logger {
+ public:
+  GlyphFont() : Logger("Glyphs") {}
+  GlyphFont(const GlyphFont&) = delete;
+  ~GlyphFont() { end(); }
+
+  // Opens the font on the mounted icon storage. False if there is none, e.g.
+  // on devices updated over the air, which keep downloading all icons. Only
+  // the first call after end() looks for it.
+  bool begin();
+  // closes the file, before the storage is unmounted
+  void end();
+
+  uint32_t count() const;
+  bool contains(const char* name);
+  // Draws the icon scaled to the bitmap into it, the bitmap is not cleared.
+  // False if the icon is not in the font.
+  bool render(const char* name, IconBitmap& bitmap);
+
+ private:
+  struct Header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t units;  // per 24 px view box
+    uint32_t count;
+    uint32_t num_blocks;
+    uint32_t size;
+  };
+
+  struct IndexEntry {
+    uint32_t hash;
+    uint16_t block;
+    uint16_t offset;  // in the inflated block
+  };
+
+  struct Block {
+    uint32_t offset;  // in the file
+    uint16_t deflated_length;
+    uint16_t length;
+  };
+
+  bool begun_ = false;
+  bool valid_ = false;
+  File file_;
+  Header header_ = {};
+
+  bool _read(uint32_t offset, void* buf, size_t len);
+  bool _find(const char* name, IndexEntry& entry);
+  bool _inflate(const Block& block, uint8_t* out);
+  bool _draw(const uint8_t* glyph, size_t len, IconBitmap& bitmap) const;
+};
+
+#endif  // HOMEBUTTONS_GLYPH_FONT_H
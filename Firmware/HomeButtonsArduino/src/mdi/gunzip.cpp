@@ -0,0 +1,197 @@
+#include "gunzip.h"
+
+#include <esp32s2/rom/miniz.h>
+
+#include "config.h"
+
+static_assert((MDI_GZIP_WINDOW & (MDI_GZIP_WINDOW - 1)) == 0,
+              "the inflater wraps its output window with a mask");
+
+// header flags of the optional fields
+static constexpr uint8_t FHCRC = 0x02;
+static constexpr uint8_t FEXTRA = 0x04;
+static constexpr uint8_t FNAME = 0x08;
+static constexpr uint8_t FCOMMENT = 0x10;
+
+static constexpr uint16_t HEADER_LEN = 10;
+
+// CRC-32 as in gzip, 4 bits at a time
+static uint32_t crc32(const uint8_t* data, size_t len, uint32_t crc) {
+  static constexpr uint32_t TABLE[16] = {
+      0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4,
+      0x4DB26158, 0x5005713C, 0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+      0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+  crc = ~crc;
+  for (size_t i = 0; i < len; i++) {
+    crc = TABLE[(crc ^ data[i]) & 0x0F] ^ (crc >> 4);
+    crc = TABLE[(crc ^ (data[i] >> 4)) & 0x0F] ^ (crc >> 4);
+  }
+  return ~crc;
+}
+
+static uint32_t read_le32(const uint8_t* data) {
+  return data[0] | (data[1] << 8) | (data[2] << 16) |
+         (static_cast<uint32_t>(data[3]) << 24);
+}
+
+Gunzip::~Gunzip() {
+  free(inflator_);
+  free(window_);
+}
+
+bool Gunzip::begin(File& out) {
+  if (inflator_ == nullptr) {
+    inflator_ =
+        static_cast<tinfl_decompressor*>(malloc(sizeof(tinfl_decompressor)));
+  }
+  if (window_ == nullptr) {
+    window_ = static_cast<uint8_t*>(malloc(MDI_GZIP_WINDOW));
+  }
+  if (inflator_ == nullptr || window_ == nullptr) {
+    error("failed to allocate %u bytes",
+          sizeof(tinfl_decompressor) + MDI_GZIP_WINDOW);
+    stage_ = Stage::FAILED;
+    return false;
+  }
+  tinfl_init(inflator_);
+  out_ = &out;
+  window_pos_ = 0;
+  stage_ = Stage::HEADER;
+  flags_ = 0;
+  header_pos_ = 0;
+  skip_ = 0;
+  crc_ = 0;
+  in_bytes_ = 0;
+  out_bytes_ = 0;
+  return true;
+}
+
+bool Gunzip::write(const uint8_t* data, size_t len) {
+  if (stage_ == Stage::FAILED) return false;
+  if (len >= sizeof(tail_)) {
+    memcpy(tail_, data + len - sizeof(tail_), sizeof(tail_));
+  } else {
+    memmove(tail_, tail_ + len, sizeof(tail_) - len);
+    memcpy(tail_ + sizeof(tail_) - len, data, len);
+  }
+  in_bytes_ += len;
+  while (len > 0 && stage_ < Stage::DEFLATE) {
+    if (!_header(*data)) return false;
+    data++;
+    len--;
+  }
+  if (len > 0 && stage_ == Stage::DEFLATE) {
+    return _inflate(data, len);
+  }
+  // after the deflate stream only the trailer follows
+  return true;
+}
+
+bool Gunzip::finish() {
+  if (stage_ == Stage::FAILED) return false;
+  if (stage_ != Stage::DONE) {
+    _fail("truncated stream");
+    return false;
+  }
+  uint32_t crc = read_le32(tail_);
+  uint32_t size = read_le32(tail_ + 4);
+  if (crc != crc_ || size != out_bytes_) {
+    error("CRC %08X / %u bytes, expected %08X / %u bytes", crc_, out_bytes_,
+          crc, size);
+    stage_ = Stage::FAILED;
+    return false;
+  }
+  debug("%u bytes inflated to %u", in_bytes_, out_bytes_);
+  return true;
+}
+
+bool Gunzip::_header(uint8_t byte) {
+  switch (stage_) {
+    case Stage::HEADER:
+      if ((header_pos_ == 0 && byte != 0x1F) ||
+          (header_pos_ == 1 && byte != 0x8B) ||
+          (header_pos_ == 2 && byte != 8)) {
+        _fail("not a gzip deflate stream");
+        return false;
+      }
+      if (header_pos_ == 3) flags_ = byte;
+      if (++header_pos_ < HEADER_LEN) return true;
+      break;
+    case Stage::EXTRA_LEN:
+      skip_ |= byte << (8 * header_pos_);
+      if (++header_pos_ < 2) return true;
+      if (skip_ > 0) {
+        stage_ = Stage::EXTRA;
+        return true;
+      }
+      break;
+    case Stage::EXTRA:
+      if (--skip_ > 0) return true;
+      break;
+    case Stage::NAME:
+    case Stage::COMMENT:
+      if (byte != 0) return true;
+      break;
+    case Stage::HEADER_CRC:
+      if (++header_pos_ < 2) return true;
+      break;
+    default:
+      return true;
+  }
+  // next optional field in the order they are stored, flags are cleared as
+  // the fields are consumed
+  header_pos_ = 0;
+  skip_ = 0;
+  if (flags_ & FEXTRA) {
+    flags_ &= ~FEXTRA;
+    stage_ = Stage::EXTRA_LEN;
+  } else if (flags_ & FNAME) {
+    flags_ &= ~FNAME;
+    stage_ = Stage::NAME;
+  } else if (flags_ & FCOMMENT) {
+    flags_ &= ~FCOMMENT;
+    stage_ = Stage::COMMENT;
+  } else if (flags_ & FHCRC) {
+    flags_ &= ~FHCRC;
+    stage_ = Stage::HEADER_CRC;
+  } else {
+    stage_ = Stage::DEFLATE;
+  }
+  return true;
+}
+
+bool Gunzip::_inflate(const uint8_t* data, size_t len) {
+  while (stage_ == Stage::DEFLATE) {
+    size_t in_size = len;
+    size_t out_size = MDI_GZIP_WINDOW - window_pos_;
+    uint8_t* out = window_ + window_pos_;
+    tinfl_status status =
+        tinfl_decompress(inflator_, data, &in_size, window_, out, &out_size,
+                         TINFL_FLAG_HAS_MORE_INPUT);
+    data += in_size;
+    len -= in_size;
+    if (out_size > 0) {
+      if (out_->write(out, out_size) != out_size) {
+        _fail("write failed");
+        return false;
+      }
+      crc_ = crc32(out, out_size, crc_);
+      out_bytes_ += out_size;
+      window_pos_ = (window_pos_ + out_size) & (MDI_GZIP_WINDOW - 1);
+    }
+    if (status == TINFL_STATUS_DONE) {
+      stage_ = Stage::DONE;
+    } else if (status < 0) {
+      _fail("invalid deflate data");
+      return false;
+    } else if (status == TINFL_STATUS_NEEDS_MORE_INPUT) {
+      break;
+    }
+  }
+  return true;
+}
+
+void Gunzip::_fail(const char* reason) {
+  error("%s after %u bytes", reason, in_bytes_);
+  stage_ = Stage::FAILED;
+}
@@ -0,0 +1,68 @@
+#ifndef HOMEBUTTONS_GUNZIP_H
+#define HOMEBUTTONS_GUNZIP_H
+
+#include <FS.h>
+
+#include "logger.h"
+
+struct tinfl_decompressor_tag;
+
+// Streaming gzip decoder on top of the inflater in ROM. Compressed data is
+// written in chunks as it arrives, the decompressed data goes straight to a
+// file. The output window is MDI_GZIP_WINDOW bytes instead of the 32 KB of
+// deflate, which is enough for files up to that size - larger files with
+// distant back references fail the CRC check instead of being stored
+// corrupted. Buffers are allocated on first use and kept until destruction,
+// so a batch of downloads allocates them once.
+class Gunzip : public Logger {
+ public:
+  static bool is_gzip(const uint8_t* data, size_t len) {
+    return len >= 2 && data[0] == 0x1F && data[1] == 0x8B;
+  }
+
+  Gunzip() : Logger("Gunzip") {}
+  Gunzip(const Gunzip&) = delete;
+  ~Gunzip();
+
+  bool begin(File& out);
+  bool write(const uint8_t* data, size_t len);
+  // true if the stream is complete and matches its CRC and length
+  bool finish();
+
+  uint32_t in_bytes() const { return in_bytes_; }
+  uint32_t out_bytes() const { return out_bytes_; }
+
+ private:
+  enum class Stage : uint8_t {
+    HEADER,
+    EXTRA_LEN,
+    EXTRA,
+    NAME,
+    COMMENT,
+    HEADER_CRC,
+    DEFLATE,
+    DONE,
+    FAILED
+  };
+
+  File* out_ = nullptr;
+  tinfl_decompressor_tag* inflator_ = nullptr;
+  uint8_t* window_ = nullptr;
+  size_t window_pos_ = 0;
+  Stage stage_ = Stage::HEADER;
+  uint8_t flags_ = 0;
+  uint16_t header_pos_ = 0;
+  uint16_t skip_ = 0;
+  // the trailer is taken from the last 8 input bytes, the inflater may have
+  // read ahead into it
+  uint8_t tail_[8];
+  uint32_t crc_ = 0;
+  uint32_t in_bytes_ = 0;
+  uint32_t out_bytes_ = 0;
+
+  bool _header(uint8_t byte);
+  bool _inflate(const uint8_t* data, size_t len);
+  void _fail(const char* reason);
+};
+
+#endif  // HOMEBUTTONS_GUNZIP_H
@@ -0,0 +1,101 @@
+#include "icon_cache.h"
+
+const IconBitmap* IconCache::get(const char* name, uint16_t size) {
+  Entry* entry = _find(name, size);
+  if (entry == nullptr) {
+    misses_++;
+    return nullptr;
+  }
+  hits_++;
+  entry->last_used = ++tick_;
+  return &entry->bitmap;
+}
+
+IconBitmap* IconCache::insert(const char* name, uint16_t size, uint16_t width,
+                              uint16_t height) {
+  size_t len = IconBitmap::get_len(width, height);
+  if (len == 0 || len > budget_) {
+    warning("'%s' size %d doesn't fit into cache", name, size);
+    return nullptr;
+  }
+
+  invalidate(name, size);
+
+  // evict until there is a free slot and enough budget
+  Entry* slot = nullptr;
+  while (true) {
+    if (slot == nullptr) {
+      for (auto& entry : entries_) {
+        if (entry.bitmap.data == nullptr) {
+          slot = &entry;
+          break;
+        }
+      }
+    }
+    if (slot != nullptr && used_ + len <= budget_) {
+      break;
+    }
+    Entry* lru = _lru();
+    if (lru == nullptr) {
+      return nullptr;
+    }
+    debug("evicting '%s' size %d", lru->name.c_str(), lru->size);
+    _free(*lru);
+  }
+
+  uint8_t* data = static_cast<uint8_t*>(calloc(len, 1));
+  if (data == nullptr) {
+    error("failed to allocate %d bytes", len);
+    return nullptr;
+  }
+  slot->name = MDIName{name};
+  slot->size = size;
+  slot->bitmap.width = width;
+  slot->bitmap.height = height;
+  slot->bitmap.data = data;
+  slot->last_used = ++tick_;
+  used_ += len;
+  return &slot->bitmap;
+}
+
+void IconCache::invalidate(const char* name, uint16_t size) {
+  Entry* entry = _find(name, size);
+  if (entry != nullptr) {
+    debug("invalidating '%s' size %d", name, size);
+    _free(*entry);
+  }
+}
+
+void IconCache::clear() {
+  for (auto& entry : entries_) {
+    _free(entry);
+  }
+}
+
+IconCache::Entry* IconCache::_find(const char* name, uint16_t size) {
+  for (auto& entry : entries_) {
+    if (entry.bitmap.data != nullptr && entry.size == size &&
+        entry.name == name) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+IconCache::Entry* IconCache::_lru() {
+  Entry* lru = nullptr;
+  for (auto& entry : entries_) {
+    if (entry.bitmap.data == nullptr) continue;
+    if (lru == nullptr || entry.last_used < lru->last_used) {
+      lru = &entry;
+    }
+  }
+  return lru;
+}
+
+void IconCache::_free(Entry& entry) {
+  if (entry.bitmap.data == nullptr) return;
+  used_ -= entry.bitmap.len();
+  free(entry.bitmap.data);
+  entry = Entry{};
+}
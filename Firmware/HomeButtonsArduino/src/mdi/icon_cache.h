@@ -0,0 +1,66 @@
+#ifndef HOMEBUTTONS_ICON_CACHE_H
+#define HOMEBUTTONS_ICON_CACHE_H
+
+#include "logger.h"
+#include "types.h"
+
+// Decoded 1-bpp icon bitmap. Rows are byte aligned, MSB first, set bit means
+// black pixel (same layout as Adafruit_GFX::drawBitmap()).
+struct IconBitmap {
+  uint16_t width = 0;
+  uint16_t height = 0;
+  uint8_t* data = nullptr;
+
+  static size_t get_len(uint16_t width, uint16_t height) {
+    return static_cast<size_t>((width + 7) / 8) * height;
+  }
+  size_t len() const { return get_len(width, height); }
+};
+
+// Bounded LRU cache of decoded icons, keyed by (name, size).
+// Memory is allocated per entry on heap and limited by a byte budget.
+class IconCache : public Logger {
+ public:
+  explicit IconCache(size_t budget) : Logger("ICache"), budget_(budget) {}
+  IconCache(const IconCache&) = delete;
+  ~IconCache() { clear(); }
+
+  // returns nullptr on miss
+  const IconBitmap* get(const char* name, uint16_t size);
+
+  // allocates a new (zeroed) entry, evicting least recently used entries
+  // if needed. Returns nullptr if the entry doesn't fit into the budget.
+  IconBitmap* insert(const char* name, uint16_t size, uint16_t width,
+                     uint16_t height);
+
+  void invalidate(const char* name, uint16_t size);
+  void clear();
+
+  uint32_t hits() const { return hits_; }
+  uint32_t misses() const { return misses_; }
+  size_t used() const { return used_; }
+  size_t budget() const { return budget_; }
+
+ private:
+  static constexpr uint8_t MAX_ENTRIES = 16;
+
+  struct Entry {
+    MDIName name{};
+    uint16_t size = 0;
+    IconBitmap bitmap{};
+    uint32_t last_used = 0;
+  };
+
+  Entry entries_[MAX_ENTRIES];
+  size_t budget_;
+  size_t used_ = 0;
+  uint32_t tick_ = 0;
+  uint32_t hits_ = 0;
+  uint32_t misses_ = 0;
+
+  Entry* _find(const char* name, uint16_t size);
+  Entry* _lru();
+  void _free(Entry& entry);
+};
+
+#endif  // HOMEBUTTONS_ICON_CACHE_H
@@ -0,0 +1,113 @@
+#include "icon_manifest.h"
+
+#include "icon_storage.h"
+
+static constexpr char PATH[] = "/mdi/manifest";
+static constexpr uint32_t MAGIC = 0x464D4248;  // "HBMF"
+
+void IconManifest::load() {
+  if (loaded_) return;
+  clear();
+  loaded_ = true;
+  File file = icon_fs().open(PATH, FILE_READ);
+  Header header;
+  if (!file ||
+      file.read(reinterpret_cast<uint8_t*>(&header), sizeof(header)) !=
+          sizeof(header) ||
+      header.magic != MAGIC || header.count > UINT16_MAX) {
+    debug("no manifest, icons count as unused");
+    clock_ = 1;
+    return;
+  }
+  size_t len = header.count * sizeof(Entry);
+  entries_ = static_cast<Entry*>(malloc(len));
+  if ((entries_ == nullptr && len > 0) ||
+      file.read(reinterpret_cast<uint8_t*>(entries_), len) != len) {
+    warning("failed to read %u entries", header.count);
+    clear();
+    loaded_ = true;
+    clock_ = header.clock + 1;
+    dirty_ = true;
+    return;
+  }
+  count_ = capacity_ = header.count;
+  clock_ = header.clock + 1;
+  evictions_ = header.evictions;
+  avoided_ = header.avoided;
+  debug("%u entries, clock %u", count_, clock_);
+}
+
+bool IconManifest::save() {
+  if (!loaded_ || !dirty_) return true;
+  File file = icon_fs().open(PATH, FILE_WRITE, true);
+  Header header = {MAGIC, clock_, count_, evictions_, avoided_};
+  size_t len = count_ * sizeof(Entry);
+  if (!file ||
+      file.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header)) !=
+          sizeof(header) ||
+      file.write(reinterpret_cast<const uint8_t*>(entries_), len) != len) {
+    error("failed to save");
+    return false;
+  }
+  dirty_ = false;
+  debug("saved %u entries", count_);
+  return true;
+}
+
+void IconManifest::clear() {
+  free(entries_);
+  entries_ = nullptr;
+  count_ = capacity_ = 0;
+  clock_ = evictions_ = avoided_ = 0;
+  loaded_ = dirty_ = false;
+}
+
+void IconManifest::touch(uint32_t hash, uint16_t size, uint32_t bytes) {
+  int32_t idx = _find(hash, size);
+  if (idx >= 0) {
+    Entry& entry = entries_[idx];
+    if (entry.last_used == clock_ && entry.bytes == bytes) return;
+    entry.last_used = clock_;
+    entry.bytes = bytes;
+    dirty_ = true;
+    return;
+  }
+  if (count_ == capacity_) {
+    uint16_t capacity = capacity_ > 0 ? 2 * capacity_ : 16;
+    Entry* grown =
+        static_cast<Entry*>(realloc(entries_, capacity * sizeof(Entry)));
+    if (grown == nullptr) {
+      error("failed to allocate %u entries", capacity);
+      return;
+    }
+    entries_ = grown;
+    capacity_ = capacity;
+  }
+  entries_[count_++] = {hash, size, 0, bytes, clock_};
+  dirty_ = true;
+}
+
+void IconManifest::remove(uint32_t hash, uint16_t size) {
+  int32_t idx = _find(hash, size);
+  if (idx < 0) return;
+  entries_[idx] = entries_[--count_];
+  dirty_ = true;
+}
+
+uint32_t IconManifest::last_used(uint32_t hash, uint16_t size) const {
+  int32_t idx = _find(hash, size);
+  return idx >= 0 ? entries_[idx].last_used : 0;
+}
+
+void IconManifest::add_evictions(uint16_t evicted, uint16_t avoided) {
+  evictions_ += evicted;
+  avoided_ += avoided;
+  dirty_ = true;
+}
+
+int32_t IconManifest::_find(uint32_t hash, uint16_t size) const {
+  for (uint16_t i = 0; i < count_; i++) {
+    if (entries_[i].hash == hash && entries_[i].size == size) return i;
+  }
+  return -1;
+}
@@ -0,0 +1,64 @@
+#ifndef HOMEBUTTONS_ICON_MANIFEST_H
+#define HOMEBUTTONS_ICON_MANIFEST_H
+
+#include <FS.h>
+
+#include "logger.h"
+
+// Usage of stored icons: name hash (IconPack::hash()), size, byte size and
+// when the icon was last drawn. There is no wall clock before the network
+// is up, so time is counted in uses - the clock advances once per load,
+// i.e. per wakeup. Kept in RAM and written back only if changed.
+class IconManifest : public Logger {
+ public:
+  struct Entry {
+    uint32_t hash;
+    uint16_t size;
+    uint16_t reserved;
+    uint32_t bytes;
+    uint32_t last_used;
+  };
+
+  IconManifest() : Logger("IManif") {}
+  IconManifest(const IconManifest&) = delete;
+  ~IconManifest() { clear(); }
+
+  // starts empty if there is no valid manifest
+  void load();
+  // writes the manifest if changed
+  bool save();
+  void clear();
+
+  void touch(uint32_t hash, uint16_t size, uint32_t bytes);
+  void remove(uint32_t hash, uint16_t size);
+  // 0 if never used since the manifest was created
+  uint32_t last_used(uint32_t hash, uint16_t size) const;
+  uint32_t clock() const { return clock_; }
+
+  // totals since the manifest was created
+  void add_evictions(uint16_t evicted, uint16_t avoided);
+  uint32_t evictions() const { return evictions_; }
+  uint32_t avoided() const { return avoided_; }
+
+ private:
+  struct Header {
+    uint32_t magic;
+    uint32_t clock;
+    uint32_t count;
+    uint32_t evictions;
+    uint32_t avoided;
+  };
+
+  bool loaded_ = false;
+  bool dirty_ = false;
+  uint32_t clock_ = 0;
+  uint32_t evictions_ = 0;
+  uint32_t avoided_ = 0;
+  Entry* entries_ = nullptr;
+  uint16_t count_ = 0;
+  uint16_t capacity_ = 0;
+
+  int32_t _find(uint32_t hash, uint16_t size) const;
+};
+
+#endif  // HOMEBUTTONS_ICON_MANIFEST_H
@@ -0,0 +1,392 @@
+#include "icon_pack.h"
+
+#include "config.h"
+#include "icon_storage.h"
+#include "utils.h"
+
+static constexpr char FOLDER[] = "/mdi";
+
+static constexpr uint32_t RECORD_MAGIC = 0x52494248;  // "HBIR"
+static constexpr uint32_t DEAD_MAGIC = 0x44494248;    // "HBID", removed
+static constexpr uint32_t FOOTER_MAGIC = 0x50494248;  // "HBIP"
+
+struct RecordHeader {
+  uint32_t magic;
+  uint32_t hash;
+  uint32_t length;
+  uint8_t format;
+  uint8_t name_len;
+  uint16_t reserved;
+};
+
+struct Footer {
+  uint32_t magic;
+  uint32_t index_offset;
+  uint32_t count;
+  uint32_t dead_bytes;
+  uint32_t checksum;  // of the index
+};
+
+static uint32_t record_size(const IconPack::Entry& entry) {
+  return sizeof(RecordHeader) + entry.name_len + entry.length;
+}
+
+uint32_t IconPack::hash(const char* name) {
+  return fnv1a(name, strlen(name));
+}
+
+bool IconPack::load(uint16_t size) {
+  if (size_ == size) return true;
+  unload();
+  size_ = size;
+  auto path = _path();
+  File file = icon_fs().open(path.c_str(), FILE_READ);
+  if (!file) {
+    // interrupted compaction, the rewritten pack is complete
+    auto tmp_path = _path("tmp");
+    if (icon_fs().exists(tmp_path.c_str()) &&
+        icon_fs().rename(tmp_path.c_str(), path.c_str())) {
+      file = icon_fs().open(path.c_str(), FILE_READ);
+    }
+  }
+  if (!file) {
+    // only icon files of earlier firmware, if any
+    _import_files();
+    return true;
+  }
+  file_size_ = file.size();
+  if (!_read_index(file)) {
+    warning("size %u: invalid index, scanning records", size_);
+    _scan(file);
+    file.close();
+    file = icon_fs().open(path.c_str(), "r+");
+    if (!file || !_write_index(file)) {
+      error("size %u: failed to write index", size_);
+      return false;
+    }
+  }
+  file.close();
+  debug("size %u: %u icons, %u bytes, %u dead", size_, count_, data_end_,
+        dead_bytes_);
+  // an import stopped by a full partition or a reset goes on, imported
+  // files are removed one by one
+  _import_files();
+  return true;
+}
+
+void IconPack::unload() {
+  free(entries_);
+  entries_ = nullptr;
+  count_ = capacity_ = 0;
+  data_end_ = dead_bytes_ = file_size_ = 0;
+  size_ = 0;
+}
+
+const IconPack::Entry* IconPack::find(uint32_t hash) const {
+  int32_t idx = _search(hash);
+  return idx >= 0 ? &entries_[idx] : nullptr;
+}
+
+File IconPack::open(const char* name) {
+  const Entry* entry = find(name);
+  if (entry == nullptr) return File();
+  File file = icon_fs().open(_path().c_str(), FILE_READ);
+  if (!file) return File();
+  RecordHeader header;
+  char stored[UINT8_MAX];
+  size_t name_len = strlen(name);
+  if (!file.seek(entry->offset) ||
+      file.read(reinterpret_cast<uint8_t*>(&header), sizeof(header)) !=
+          sizeof(header) ||
+      header.magic != RECORD_MAGIC || header.hash != entry->hash ||
+      file.read(reinterpret_cast<uint8_t*>(stored), header.name_len) !=
+          header.name_len) {
+    error("size %u: damaged record at %u", size_, entry->offset);
+    return File();
+  }
+  if (header.name_len != name_len || memcmp(stored, name, name_len) != 0) {
+    debug("'%s' collides with '%.*s'", name, header.name_len, stored);
+    return File();
+  }
+  return file;
+}
+
+bool IconPack::add(const char* name, File& src, size_t len, Format format) {
+  size_t name_len = strlen(name);
+  if (name_len > UINT8_MAX) {
+    error("name '%s' too long", name);
+    return false;
+  }
+  File file = icon_fs().open(_path().c_str(),
+                             file_size_ > 0 ? "r+" : FILE_WRITE, true);
+  if (!file) {
+    error("size %u: failed to open pack", size_);
+    return false;
+  }
+  uint32_t key = hash(name);
+  RecordHeader header = {RECORD_MAGIC, key, static_cast<uint32_t>(len),
+                         format, static_cast<uint8_t>(name_len), 0};
+  file.seek(data_end_);
+  bool ok =
+      file.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header)) ==
+          sizeof(header) &&
+      file.write(reinterpret_cast<const uint8_t*>(name), name_len) == name_len;
+  uint8_t buf[256];
+  size_t copied = 0;
+  while (ok && copied < len) {
+    size_t n = src.read(buf, std::min(sizeof(buf), len - copied));
+    ok = n > 0 && file.write(buf, n) == n;
+    copied += n;
+  }
+  file_size_ = std::max<uint32_t>(file_size_, file.position());
+  if (!ok) {
+    // the incomplete record is invalidated and overwritten by the index
+    error("size %u: failed to add '%s'", size_, name);
+    uint32_t magic = 0;
+    file.seek(data_end_);
+    file.write(reinterpret_cast<const uint8_t*>(&magic), sizeof(magic));
+    _write_index(file);
+    return false;
+  }
+  Entry entry = {key, data_end_, static_cast<uint32_t>(len), format,
+                 static_cast<uint8_t>(name_len), 0};
+  data_end_ = file.position();
+  int32_t idx = _search(key);
+  if (idx >= 0) {
+    _remove_at(idx, file);
+  }
+  _insert(entry);
+  return _write_index(file);
+}
+
+bool IconPack::remove(uint32_t hash) {
+  int32_t idx = _search(hash);
+  if (idx < 0) return false;
+  File file = icon_fs().open(_path().c_str(), "r+");
+  if (!file) return false;
+  _remove_at(idx, file);
+  return _write_index(file);
+}
+
+bool IconPack::fragmented() const {
+  return dead_bytes_ > 0 &&
+         dead_bytes_ * 100 > data_end_ * MDI_PACK_COMPACT_THRESHOLD;
+}
+
+bool IconPack::compact() {
+  auto path = _path();
+  auto tmp_path = _path("tmp");
+  File src = icon_fs().open(path.c_str(), FILE_READ);
+  File dst = icon_fs().open(tmp_path.c_str(), FILE_WRITE, true);
+  if (!src || !dst) {
+    error("size %u: failed to open files for compaction", size_);
+    return false;
+  }
+  uint32_t start = millis();
+  uint32_t before = file_size_;
+  uint8_t buf[256];
+  bool ok = true;
+  for (uint16_t i = 0; ok && i < count_; i++) {
+    Entry& entry = entries_[i];
+    uint32_t len = record_size(entry);
+    uint32_t offset = dst.position();
+    ok = src.seek(entry.offset);
+    while (ok && len > 0) {
+      size_t n = src.read(buf, std::min<uint32_t>(sizeof(buf), len));
+      ok = n > 0 && dst.write(buf, n) == n;
+      len -= n;
+    }
+    entry.offset = offset;
+  }
+  if (ok) {
+    data_end_ = dst.position();
+    dead_bytes_ = 0;
+    file_size_ = data_end_;
+    ok = _write_index(dst);
+  }
+  src.close();
+  dst.close();
+  if (!ok) {
+    // offsets in the index are partly rewritten, reload the old pack
+    error("size %u: compaction failed", size_);
+    icon_fs().remove(tmp_path.c_str());
+    uint16_t size = size_;
+    unload();
+    load(size);
+    return false;
+  }
+  icon_fs().remove(path.c_str());
+  if (!icon_fs().rename(tmp_path.c_str(), path.c_str())) {
+    error("size %u: failed to rename '%s'", size_, tmp_path.c_str());
+    return false;
+  }
+  info("size %u: compacted %u -> %u bytes in %u ms", size_, before,
+       file_size_, millis() - start);
+  return true;
+}
+
+bool IconPack::erase() {
+  auto path = _path();
+  uint16_t size = size_;
+  unload();
+  size_ = size;
+  return icon_fs().remove(path.c_str());
+}
+
+StaticString<24> IconPack::_path(const char* ext) const {
+  return StaticString<24>("%s/%u.%s", FOLDER, size_, ext);
+}
+
+int32_t IconPack::_search(uint32_t hash) const {
+  int32_t lo = 0;
+  int32_t hi = static_cast<int32_t>(count_) - 1;
+  while (lo <= hi) {
+    int32_t mid = (lo + hi) / 2;
+    if (entries_[mid].hash == hash) return mid;
+    if (entries_[mid].hash < hash) {
+      lo = mid + 1;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  return -(lo + 1);  // insertion point
+}
+
+bool IconPack::_reserve(uint16_t capacity) {
+  if (capacity <= capacity_) return true;
+  capacity = std::max<uint16_t>(capacity, capacity_ * 2);
+  Entry* grown =
+      static_cast<Entry*>(realloc(entries_, capacity * sizeof(Entry)));
+  if (grown == nullptr) {
+    error("failed to allocate index of %u entries", capacity);
+    return false;
+  }
+  entries_ = grown;
+  capacity_ = capacity;
+  return true;
+}
+
+void IconPack::_insert(const Entry& entry) {
+  int32_t idx = _search(entry.hash);
+  if (idx >= 0) {
+    // replaced by a later record (index rebuilt from the records)
+    dead_bytes_ += record_size(entries_[idx]);
+    entries_[idx] = entry;
+    return;
+  }
+  if (!_reserve(count_ + 1)) {
+    dead_bytes_ += record_size(entry);
+    return;
+  }
+  idx = -idx - 1;
+  memmove(&entries_[idx + 1], &entries_[idx], (count_ - idx) * sizeof(Entry));
+  entries_[idx] = entry;
+  count_++;
+}
+
+void IconPack::_remove_at(uint16_t idx, File& file) {
+  // marked, so a rebuilt index does not bring the icon back
+  uint32_t magic = DEAD_MAGIC;
+  file.seek(entries_[idx].offset);
+  file.write(reinterpret_cast<const uint8_t*>(&magic), sizeof(magic));
+  dead_bytes_ += record_size(entries_[idx]);
+  memmove(&entries_[idx], &entries_[idx + 1],
+          (count_ - idx - 1) * sizeof(Entry));
+  count_--;
+}
+
+bool IconPack::_read_index(File& file) {
+  Footer footer;
+  if (file_size_ < sizeof(footer) ||
+      !file.seek(file_size_ - sizeof(footer)) ||
+      file.read(reinterpret_cast<uint8_t*>(&footer), sizeof(footer)) !=
+          sizeof(footer) ||
+      footer.magic != FOOTER_MAGIC || footer.count > UINT16_MAX ||
+      footer.index_offset + footer.count * sizeof(Entry) >
+          file_size_ - sizeof(footer) ||
+      !_reserve(footer.count)) {
+    return false;
+  }
+  size_t len = footer.count * sizeof(Entry);
+  if (!file.seek(footer.index_offset) ||
+      file.read(reinterpret_cast<uint8_t*>(entries_), len) != len ||
+      fnv1a(entries_, len) != footer.checksum) {
+    return false;
+  }
+  count_ = footer.count;
+  data_end_ = footer.index_offset;
+  dead_bytes_ = footer.dead_bytes;
+  return true;
+}
+
+void IconPack::_scan(File& file) {
+  count_ = 0;
+  dead_bytes_ = 0;
+  uint32_t pos = 0;
+  RecordHeader header;
+  while (file.seek(pos) &&
+         file.read(reinterpret_cast<uint8_t*>(&header), sizeof(header)) ==
+             sizeof(header) &&
+         (header.magic == RECORD_MAGIC || header.magic == DEAD_MAGIC)) {
+    Entry entry = {header.hash, pos, header.length, header.format,
+                   header.name_len, 0};
+    uint32_t end = pos + record_size(entry);
+    if (end > file_size_) break;
+    if (header.magic == RECORD_MAGIC) {
+      _insert(entry);
+    } else {
+      dead_bytes_ += record_size(entry);
+    }
+    pos = end;
+  }
+  data_end_ = pos;
+}
+
+bool IconPack::_write_index(File& file) {
+  size_t len = count_ * sizeof(Entry);
+  Footer footer = {FOOTER_MAGIC, data_end_, count_, dead_bytes_,
+                   fnv1a(entries_, len)};
+  // files can't be truncated, the footer stays at the end of the file
+  uint32_t footer_pos = data_end_ + len;
+  if (file_size_ >= footer_pos + sizeof(footer)) {
+    footer_pos = file_size_ - sizeof(footer);
+  }
+  if (!file.seek(data_end_) ||
+      file.write(reinterpret_cast<const uint8_t*>(entries_), len) != len ||
+      !file.seek(footer_pos) ||
+      file.write(reinterpret_cast<const uint8_t*>(&footer), sizeof(footer)) !=
+          sizeof(footer)) {
+    error("size %u: failed to write index", size_);
+    return false;
+  }
+  file_size_ = std::max<uint32_t>(file_size_, footer_pos + sizeof(footer));
+  return true;
+}
+
+void IconPack::_import_files() {
+  StaticString<24> folder("%s/%u", FOLDER, size_);
+  File root = icon_fs().open(folder.c_str());
+  if (!root || !root.isDirectory()) return;
+  uint16_t count = 0;
+  while (File file = root.openNextFile()) {
+    StaticString<UINT8_MAX + 24> path(file.path());
+    const char* base = strrchr(path.c_str(), '/');
+    base = base != nullptr ? base + 1 : path.c_str();
+    const char* ext = strrchr(base, '.');
+    if (ext == nullptr || strcmp(ext, ".bmp") != 0) continue;
+    StaticString<UINT8_MAX> name("%.*s", static_cast<int>(ext - base), base);
+    // appended before a reset that kept the file
+    bool ok = find(name.c_str()) != nullptr ||
+              add(name.c_str(), file, file.size());
+    file.close();
+    if (!ok) {
+      warning("size %u: import stopped at '%s'", size_, name.c_str());
+      break;
+    }
+    icon_fs().remove(path.c_str());
+    count++;
+  }
+  if (count > 0) {
+    info("size %u: imported %u icons", size_, count);
+  }
+}
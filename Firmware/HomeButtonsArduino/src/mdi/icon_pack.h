@@ -0,0 +1,86 @@
+#ifndef HOMEBUTTONS_ICON_PACK_H
+#define HOMEBUTTONS_ICON_PACK_H
+
+#include <FS.h>
+
+#include "logger.h"
+#include "static_string.h"
+
+// Append-only archive of all icons of one size, instead of one SPIFFS file
+// per icon. Records (header, name, data) are appended to the data area,
+// followed by the index sorted by name hash and a footer:
+//
+//   [record]... [index entry]... [padding] [footer]
+//
+// The index is kept in RAM, lookups are a binary search instead of a SPIFFS
+// path lookup. A damaged index (e.g. power loss during an append) is rebuilt
+// by scanning the records. Replaced and removed records stay in the file as
+// dead bytes until compact() rewrites it.
+class IconPack : public Logger {
+ public:
+  enum Format : uint8_t { FORMAT_BMP = 1 };
+
+  struct Entry {
+    uint32_t hash;
+    uint32_t offset;  // of the record
+    uint32_t length;  // of the icon data
+    uint8_t format;
+    uint8_t name_len;
+    uint16_t reserved;
+  };
+
+  IconPack() : Logger("IPack") {}
+  IconPack(const IconPack&) = delete;
+  ~IconPack() { unload(); }
+
+  // key of icons in the index
+  static uint32_t hash(const char* name);
+
+  // Reads the index of the pack for size. On first use icons stored as
+  // single files are moved into the pack.
+  bool load(uint16_t size);
+  void unload();
+  uint16_t size() const { return size_; }
+
+  const Entry* find(const char* name) const { return find(hash(name)); }
+  const Entry* find(uint32_t hash) const;
+  // returns the pack file positioned at the icon data
+  File open(const char* name);
+  // appends len bytes read from src, replaces an icon with the same name
+  bool add(const char* name, File& src, size_t len,
+           Format format = FORMAT_BMP);
+  bool remove(const char* name) { return remove(hash(name)); }
+  bool remove(uint32_t hash);
+  // true if dead bytes exceed MDI_PACK_COMPACT_THRESHOLD
+  bool fragmented() const;
+  // rewrites the pack without dead bytes
+  bool compact();
+  // deletes the pack file
+  bool erase();
+
+  uint16_t count() const { return count_; }
+  const Entry& entry(uint16_t idx) const { return entries_[idx]; }
+  uint32_t data_bytes() const { return data_end_; }
+  uint32_t dead_bytes() const { return dead_bytes_; }
+
+ private:
+  uint16_t size_ = 0;  // 0 if not loaded
+  Entry* entries_ = nullptr;
+  uint16_t count_ = 0;
+  uint16_t capacity_ = 0;
+  uint32_t data_end_ = 0;
+  uint32_t dead_bytes_ = 0;
+  uint32_t file_size_ = 0;
+
+  StaticString<24> _path(const char* ext = "pack") const;
+  int32_t _search(uint32_t hash) const;
+  bool _reserve(uint16_t capacity);
+  void _insert(const Entry& entry);
+  void _remove_at(uint16_t idx, File& file);
+  bool _read_index(File& file);
+  void _scan(File& file);
+  bool _write_index(File& file);
+  void _import_files();
+};
+
+#endif  // HOMEBUTTONS_ICON_PACK_H
@@ -0,0 +1,106 @@
+#include "icon_storage.h"
+
+#include <SPIFFS.h>
+#if defined(HOME_BUTTONS_ICONS_LITTLEFS)
+#include <LittleFS.h>
+#endif
+
+bool IconStorage::mountable() {
+  if (!begin()) {
+    return false;
+  }
+  end();
+  debug("test mount OK");
+  return true;
+}
+
+bool SpiffsStorage::begin() { return SPIFFS.begin(); }
+
+void SpiffsStorage::end() { SPIFFS.end(); }
+
+bool SpiffsStorage::format() { return SPIFFS.format(); }
+
+size_t SpiffsStorage::total_bytes() { return SPIFFS.totalBytes(); }
+
+size_t SpiffsStorage::used_bytes() { return SPIFFS.usedBytes(); }
+
+fs::FS& SpiffsStorage::fs() { return SPIFFS; }
+
+#if defined(HOME_BUTTONS_ICONS_LITTLEFS)
+static constexpr char GLYPHS_PATH[] = "/glyphs.bin";
+
+bool LittleFsStorage::begin() {
+  spiffs_ = false;
+  if (LittleFS.begin()) {
+    return true;
+  }
+  // still SPIFFS, e.g. the first boot after an OTA update, which may be a
+  // wake from deep sleep
+  if (_spiffs_font()) {
+    spiffs_ = SPIFFS.begin();
+    return spiffs_;
+  }
+  return format() && LittleFS.begin();
+}
+
+void LittleFsStorage::end() {
+  if (spiffs_) {
+    SPIFFS.end();
+  } else {
+    LittleFS.end();
+  }
+}
+
+bool LittleFsStorage::format() {
+  if (_spiffs_font()) {
+    return false;
+  }
+  if (SPIFFS.begin()) {
+    // the icons are a copy of the server, they are downloaded again
+    info("migrating from SPIFFS, %u bytes of icons dropped",
+         SPIFFS.usedBytes());
+    SPIFFS.end();
+  }
+  // the partition label is only known after begin(), which formats if the
+  // partition holds no LittleFS
+  bool ok = LittleFS.begin(true) && LittleFS.format();
+  LittleFS.end();
+  return ok;
+}
+
+size_t LittleFsStorage::total_bytes() {
+  return spiffs_ ? SPIFFS.totalBytes() : LittleFS.totalBytes();
+}
+
+size_t LittleFsStorage::used_bytes() {
+  return spiffs_ ? SPIFFS.usedBytes() : LittleFS.usedBytes();
+}
+
+fs::FS& LittleFsStorage::fs() {
+  if (spiffs_) return SPIFFS;
+  return LittleFS;
+}
+
+// The glyph font can't be kept over a format, the partition can't hold both
+// file systems and the font doesn't fit in RAM.
+bool LittleFsStorage::_spiffs_font() {
+  if (!SPIFFS.begin()) {
+    return false;
+  }
+  bool font = SPIFFS.exists(GLYPHS_PATH);
+  SPIFFS.end();
+  if (font) {
+    warning("SPIFFS holds the glyph font, kept until LittleFS is uploaded");
+  }
+  return font;
+}
+#endif
+
+IconStorage& icon_storage() {
+#if defined(HOME_BUTTONS_ICONS_LITTLEFS)
+  static LittleFsStorage storage;
+#else
+  static SpiffsStorage storage;
+#endif
+  return storage;
+}
@@ -0,0 +1,78 @@
+#ifndef HOMEBUTTONS_ICON_STORAGE_H
+#define HOMEBUTTONS_ICON_STORAGE_H
+
+#include <FS.h>
+
+#include "logger.h"
+
+// File system on the "spiffs" partition that holds the downloaded icons, the
+// icon packs, the manifest, the validators and the glyph font. SPIFFS unless
+// built with HOME_BUTTONS_ICONS_LITTLEFS. LittleFS has real directories,
+// lookups that don't scan the whole partition and keeps its write speed when
+// nearly full. The partition holds one or the other. A LittleFS build finds
+// a SPIFFS partition at the first mount (after an OTA update, on any boot
+// path) and formats it, the icons are downloaded again. The glyph font can
+// only be uploaded over USB, a SPIFFS partition that holds one is kept and
+// used until LittleFS is flashed.
+class IconStorage : public Logger {
+ public:
+  explicit IconStorage(const char* name) : Logger(name), name_(name) {}
+  IconStorage(const IconStorage&) = delete;
+  virtual ~IconStorage() = default;
+
+  const char* name() const { return name_; }
+  virtual bool begin() = 0;
+  virtual void end() = 0;
+  // erases the partition, must not be mounted
+  virtual bool format() = 0;
+  virtual size_t total_bytes() = 0;
+  virtual size_t used_bytes() = 0;
+  // paths are the same on both, directories are created by open()
+  virtual fs::FS& fs() = 0;
+
+  // mounts and unmounts again, false if the partition needs a format()
+  bool mountable();
+
+ private:
+  const char* name_;
+};
+
+class SpiffsStorage : public IconStorage {
+ public:
+  SpiffsStorage() : IconStorage("SPIFFS") {}
+
+  bool begin() override;
+  void end() override;
+  bool format() override;
+  size_t total_bytes() override;
+  size_t used_bytes() override;
+  fs::FS& fs() override;
+};
+
+#if defined(HOME_BUTTONS_ICONS_LITTLEFS)
+class LittleFsStorage : public IconStorage {
+ public:
+  LittleFsStorage() : IconStorage("LittleFS") {}
+
+  // migrates a partition that still holds SPIFFS, unless it holds the glyph
+  // font
+  bool begin() override;
+  void end() override;
+  // refused while the partition holds SPIFFS with the glyph font
+  bool format() override;
+  size_t total_bytes() override;
+  size_t used_bytes() override;
+  fs::FS& fs() override;
+
+ private:
+  bool spiffs_ = false;  // mounted SPIFFS, kept for the glyph font
+
+  bool _spiffs_font();
+};
+#endif
+
+// storage of this build, created at the first call (after setup(), it logs)
+IconStorage& icon_storage();
+inline fs::FS& icon_fs() { return icon_storage().fs(); }
+
+#endif  // HOMEBUTTONS_ICON_STORAGE_H
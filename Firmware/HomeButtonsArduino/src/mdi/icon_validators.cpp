@@ -0,0 +1,158 @@
+#include "icon_validators.h"
+
+#include "icon_storage.h"
+
+static constexpr char PATH[] = "/mdi/validators";
+static constexpr uint32_t MAGIC = 0x41564248;  // "HBVA"
+
+void IconValidators::load() {
+  if (loaded_) return;
+  clear();
+  loaded_ = true;
+  File file = icon_fs().open(PATH, FILE_READ);
+  Header header;
+  if (!file ||
+      file.read(reinterpret_cast<uint8_t*>(&header), sizeof(header)) !=
+          sizeof(header) ||
+      header.magic != MAGIC || header.count > UINT16_MAX) {
+    debug("no validators");
+    return;
+  }
+  entries_ = static_cast<Entry*>(malloc(header.count * sizeof(Entry)));
+  if (entries_ == nullptr && header.count > 0) {
+    warning("failed to allocate %u entries", header.count);
+    dirty_ = true;
+    return;
+  }
+  capacity_ = header.count;
+  for (uint32_t i = 0; i < header.count; i++) {
+    Record record;
+    char value[MDI_VALIDATOR_MAXLEN + 1];
+    if (file.read(reinterpret_cast<uint8_t*>(&record), sizeof(record)) !=
+            sizeof(record) ||
+        record.len > MDI_VALIDATOR_MAXLEN ||
+        file.read(reinterpret_cast<uint8_t*>(value), record.len) !=
+            record.len) {
+      warning("damaged after %u entries", count_);
+      dirty_ = true;
+      break;
+    }
+    value[record.len] = '\0';
+    Entry& entry = entries_[count_++];
+    entry.hash = record.hash;
+    entry.size = record.size;
+    entry.checked = record.checked;
+    entry.validator.kind = static_cast<download::Validator::Kind>(record.kind);
+    entry.validator.value = value;
+  }
+  partial_hash_ = header.partial_hash;
+  partial_size_ = header.partial_size;
+  partial_length_ = header.partial_length;
+  debug("%u entries", count_);
+}
+
+bool IconValidators::save() {
+  if (!loaded_ || !dirty_) return true;
+  File file = icon_fs().open(PATH, FILE_WRITE, true);
+  Header header = {MAGIC,          count_, partial_hash_, partial_size_, 0,
+                   partial_length_};
+  bool ok = file && file.write(reinterpret_cast<const uint8_t*>(&header),
+                               sizeof(header)) == sizeof(header);
+  for (uint16_t i = 0; ok && i < count_; i++) {
+    const Entry& entry = entries_[i];
+    uint8_t len = entry.validator.value.length();
+    Record record = {entry.hash, entry.size,
+                     static_cast<uint8_t>(entry.validator.kind), len,
+                     entry.checked};
+    ok = file.write(reinterpret_cast<const uint8_t*>(&record),
+                    sizeof(record)) == sizeof(record) &&
+         file.write(reinterpret_cast<const uint8_t*>(
+                        entry.validator.value.c_str()),
+                    len) == len;
+  }
+  if (!ok) {
+    error("failed to save");
+    return false;
+  }
+  dirty_ = false;
+  debug("saved %u entries", count_);
+  return true;
+}
+
+void IconValidators::clear() {
+  free(entries_);
+  entries_ = nullptr;
+  count_ = capacity_ = 0;
+  partial_hash_ = partial_size_ = partial_length_ = 0;
+  loaded_ = dirty_ = false;
+}
+
+bool IconValidators::get(uint32_t hash, uint16_t size,
+                         download::Validator& validator,
+                         uint32_t* checked) const {
+  int32_t idx = _find(hash, size);
+  if (idx < 0) return false;
+  validator = entries_[idx].validator;
+  if (checked != nullptr) *checked = entries_[idx].checked;
+  return true;
+}
+
+void IconValidators::set(uint32_t hash, uint16_t size,
+                         const download::Validator& validator,
+                         uint32_t checked) {
+  if (validator.kind == download::Validator::NONE) {
+    remove(hash, size);
+    return;
+  }
+  int32_t idx = _find(hash, size);
+  if (idx < 0) {
+    if (count_ == capacity_) {
+      uint16_t capacity = capacity_ > 0 ? 2 * capacity_ : 16;
+      Entry* grown =
+          static_cast<Entry*>(realloc(entries_, capacity * sizeof(Entry)));
+      if (grown == nullptr) {
+        error("failed to allocate %u entries", capacity);
+        return;
+      }
+      entries_ = grown;
+      capacity_ = capacity;
+    }
+    idx = count_++;
+  }
+  entries_[idx] = {hash, size, checked, validator};
+  dirty_ = true;
+}
+
+void IconValidators::remove(uint32_t hash, uint16_t size) {
+  if (partial_length_ > 0 && partial_hash_ == hash && partial_size_ == size) {
+    set_partial(0, 0, 0);
+  }
+  int32_t idx = _find(hash, size);
+  if (idx < 0) return;
+  entries_[idx] = entries_[--count_];
+  dirty_ = true;
+}
+
+void IconValidators::set_partial(uint32_t hash, uint16_t size,
+                                 uint32_t length) {
+  if (length == 0) hash = size = 0;
+  if (partial_hash_ == hash && partial_size_ == size &&
+      partial_length_ == length) {
+    return;
+  }
+  partial_hash_ = hash;
+  partial_size_ = size;
+  partial_length_ = length;
+  dirty_ = true;
+}
+
+uint32_t IconValidators::partial(uint32_t hash, uint16_t size) const {
+  return partial_hash_ == hash && partial_size_ == size ? partial_length_ : 0;
+}
+
+int32_t IconValidators::_find(uint32_t hash, uint16_t size) const {
+  for (uint16_t i = 0; i < count_; i++) {
+    if (entries_[i].hash == hash && entries_[i].size == size) return i;
+  }
+  return -1;
+}
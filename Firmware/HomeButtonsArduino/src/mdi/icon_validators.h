@@ -0,0 +1,75 @@
+#ifndef HOMEBUTTONS_ICON_VALIDATORS_H
+#define HOMEBUTTONS_ICON_VALIDATORS_H
+
+#include <FS.h>
+
+#include "download.h"
+#include "logger.h"
+
+// HTTP validators (ETag or Last-Modified) of downloaded icons, keyed by name
+// hash (IconPack::hash()) and size, with the manifest clock of the last check
+// with the server. Also remembers which icon the partial download file
+// belongs to. Only needed while downloading, so kept apart from the manifest
+// that is loaded on every wakeup.
+class IconValidators : public Logger {
+ public:
+  IconValidators() : Logger("IValid") {}
+  IconValidators(const IconValidators&) = delete;
+  ~IconValidators() { clear(); }
+
+  // starts empty if there are no valid validators
+  void load();
+  // writes the validators if changed
+  bool save();
+  void clear();
+
+  // false if there is none
+  bool get(uint32_t hash, uint16_t size, download::Validator& validator,
+           uint32_t* checked = nullptr) const;
+  void set(uint32_t hash, uint16_t size, const download::Validator& validator,
+           uint32_t checked);
+  void remove(uint32_t hash, uint16_t size);
+
+  // the download file holds the first length bytes of the icon, 0 if none
+  void set_partial(uint32_t hash, uint16_t size, uint32_t length);
+  uint32_t partial(uint32_t hash, uint16_t size) const;
+  uint32_t partial_length() const { return partial_length_; }
+
+ private:
+  struct Header {
+    uint32_t magic;
+    uint32_t count;
+    uint32_t partial_hash;
+    uint16_t partial_size;
+    uint16_t reserved;
+    uint32_t partial_length;
+  };
+
+  struct Record {
+    uint32_t hash;
+    uint16_t size;
+    uint8_t kind;
+    uint8_t len;  // of the value that follows
+    uint32_t checked;
+  };
+
+  struct Entry {
+    uint32_t hash;
+    uint16_t size;
+    uint32_t checked;
+    download::Validator validator;
+  };
+
+  bool loaded_ = false;
+  bool dirty_ = false;
+  Entry* entries_ = nullptr;
+  uint16_t count_ = 0;
+  uint16_t capacity_ = 0;
+  uint32_t partial_hash_ = 0;
+  uint16_t partial_size_ = 0;
+  uint32_t partial_length_ = 0;
+
+  int32_t _find(uint32_t hash, uint16_t size) const;
+};
+
+#endif  // HOMEBUTTONS_ICON_VALIDATORS_H
@@ -13,17 +13,34 @@ static constexpr char TEST_URL[] =
 
 static constexpr char FOLDER[] = "/mdi";
 
-bool MDIHelper::begin() {
-  if (spiffs_mounted_) {
-    return true;
+static constexpr char DOWNLOAD_PATH[] = "/mdi/download.tmp";
+
+MDIHelper::Session::Session(MDIHelper& mdi)
+    : mdi_(mdi),
+      start_mounts_(mdi.mount_count_),
+      start_lookups_(mdi.lookup_count_),
+      start_lookup_us_(mdi.lookup_us_) {
+  Lock lock(mdi_);
+  mdi_.session_count_++;
+}
+
+MDIHelper::Session::~Session() {
+  Lock lock(mdi_);
+  if (--mdi_.session_count_ == 0 && mdi_.begin_count_ == 0) {
+    mdi_._unmount();
   }
-  if (!SPIFFS.begin()) {
-    error("Failed to mount SPIFFS file system");
+  mdi_.debug("session: %u mounts, %u lookups in %u us",
+             mdi_.mount_count_ - start_mounts_,
+             mdi_.lookup_count_ - start_lookups_,
+             mdi_.lookup_us_ - start_lookup_us_);
+}
+
+bool MDIHelper::begin() {
+  Lock lock(*this);
+  if (!_mount()) {
     return false;
   }
-
-  spiffs_mounted_ = true;
-  debug("Mounted SPIFFS file system");
+  begin_count_++;
   return true;
 }
 
@@ -36,65 +53,295 @@ void MDIHelper::add_size(uint16_t size) {
 }
 
 void MDIHelper::end() {
-  if (!spiffs_mounted_) {
+  Lock lock(*this);
+  if (begin_count_ == 0) {
     return;
   }
-  SPIFFS.end();
-  spiffs_mounted_ = false;
-  debug("Unmounted SPIFFS file system");
+  if (--begin_count_ == 0 && session_count_ == 0) {
+    _unmount();
+  }
 }
 
-StaticString<MAX_PATH_LEN> MDIHelper::_get_path(const char* name,
-                                                uint16_t size) {
-  return StaticString<MAX_PATH_LEN>("%s/%d/%s.bmp", FOLDER, size, name);
+bool MDIHelper::_mount() {
+  if (mounted_) {
+    return true;
+  }
+  if (!icon_storage().begin()) {
+    error("Failed to mount %s file system", icon_storage().name());
+    return false;
+  }
+
+  mounted_ = true;
+  mount_count_++;
+  debug("Mounted %s file system", icon_storage().name());
+  return true;
 }
 
-bool MDIHelper::check_connection() {
-  return download::check_connection(HOST, TEST_URL,
-                                    github_raw_cert::DigiCert_Global_Root_G2);
+void MDIHelper::_unmount() {
+  if (!mounted_) {
+    return;
+  }
+  manifest_.save();
+  // only needed while downloading
+  validators_.save();
+  validators_.clear();
+  glyphs_.end();
+  icon_storage().end();
+  mounted_ = false;
+  debug("Unmounted %s file system", icon_storage().name());
 }
 
-bool MDIHelper::download(const char* name, uint16_t size) {
-  if (!spiffs_mounted_) {
-    error("SPIFFS not mounted");
+bool MDIHelper::_ready() {
+  if (mounted_) {
+    return true;
+  }
+  if (session_count_ > 0) {
+    return _mount();
+  }
+  error("%s not mounted", icon_storage().name());
+  return false;
+}
+
+IconPack* MDIHelper::_get_pack(uint16_t size) {
+  IconPack* pack = nullptr;
+  for (auto& p : packs_) {
+    if (p.size() == size) return &p;
+    if (pack == nullptr && p.size() == 0) pack = &p;
+  }
+  if (pack == nullptr) {
+    pack = &packs_[MAX_NUM_PACKS - 1];
+  }
+  if (!pack->load(size)) {
+    pack->unload();
+    return nullptr;
+  }
+  return pack;
+}
+
+size_t MDIHelper::_dead_bytes() {
+  size_t dead = 0;
+  for (auto& pack : packs_) {
+    dead += pack.dead_bytes();
+  }
+  return dead;
+}
+
+size_t MDIHelper::_drop_cache() {
+  File root = icon_fs().open(CACHE_FOLDER);
+  if (!root || !root.isDirectory()) return 0;
+  size_t bytes = 0;
+  uint16_t count = 0;
+  while (File file = root.openNextFile()) {
+    StaticString<MAX_PATH_LEN> path(file.path());
+    size_t size = file.size();
+    file.close();
+    if (icon_fs().remove(path.c_str())) {
+      bytes += size;
+      count++;
+    }
+  }
+  if (count > 0) {
+    info("Dropped %u cached files, %u bytes", count, bytes);
+  }
+  return bytes;
+}
+
+void MDIHelper::set_base_url(const char* url) {
+  Lock lock(*this);
+  if (url == nullptr || url[0] == '\0') {
+    base_url_ = MDI_URL;
+    try_gzip_ = false;
+  } else {
+    base_url_ = url;
+    if (base_url_[base_url_.length() - 1] != '/') base_url_ += '/';
+    try_gzip_ = true;
+  }
+  debug("icon server: %s", base_url_.c_str());
+}
+
+void MDIHelper::begin_downloads() {
+  if (client_ == nullptr) {
+    replaced_icons_ = 0;
+    client_ = new download::Client(github_raw_cert::DigiCert_Global_Root_G2);
+  }
+}
+
+void MDIHelper::end_downloads() {
+  if (client_ == nullptr) {
+    return;
+  }
+  client_->end();
+  info("%u downloads (%u gzipped), %u connections (%u ms), %u bytes "
+       "received, %u stored, %u ms",
+       client_->requests(), client_->gzipped(), client_->connects(),
+       client_->connect_ms(), client_->bytes(), client_->stored_bytes(),
+       client_->time_ms());
+  if (client_->requests() > 0) {
+    info("per download: %u bytes received, %u ms",
+         client_->bytes() / client_->requests(),
+         client_->time_ms() / client_->requests());
+  }
+  delete client_;
+  client_ = nullptr;
+}
+
+bool MDIHelper::has_glyph(const char* name) {
+  Lock lock(*this);
+  return _ready() && glyphs_.begin() && glyphs_.contains(name);
+}
+
+bool MDIHelper::render_glyph(const char* name, IconBitmap& bitmap) {
+  Lock lock(*this);
+  return _ready() && glyphs_.begin() && glyphs_.render(name, bitmap);
+}
+
+bool MDIHelper::server_reachable() const {
+  return client_ == nullptr || client_->requests() == 0 ||
+         client_->connects() > 0;
+}
+
+bool MDIHelper::_revalidation_due(const char* name, uint16_t size) {
+  manifest_.load();
+  validators_.load();
+  download::Validator validator;
+  uint32_t checked;
+  return validators_.get(IconPack::hash(name), size, validator, &checked) &&
+         manifest_.clock() - checked >= MDI_REVALIDATE_INTERVAL;
+}
+
+// Opens the download file positioned after length bytes of a partial
+// download, or empty with length 0 if there is none.
+File MDIHelper::_open_download(uint32_t& length) {
+  if (length > 0) {
+    File file = icon_fs().open(DOWNLOAD_PATH, "r+");
+    if (file && file.size() >= length && file.seek(length)) {
+      return file;
+    }
+    length = 0;
+  }
+  return icon_fs().open(DOWNLOAD_PATH, FILE_WRITE, true);
+}
+
+bool MDIHelper::needs_download(const char* name, uint16_t size) {
+  Lock lock(*this);
+  if (has_glyph(name)) {
     return false;
   }
+  return !exists(name, size) || _revalidation_due(name, size);
+}
 
-  auto path = _get_path(name, size);
+bool MDIHelper::needs_download(const char* name) {
+  Lock lock(*this);
+  for (uint8_t i = 0; i < num_sizes_; ++i) {
+    if (needs_download(name, sizes_[i])) {
+      return true;
+    }
+  }
+  return false;
+}
 
-  if (SPIFFS.exists(path.c_str())) {
-    info("'%s' size %d already exists", name, size);
-    return true;
+uint32_t MDIHelper::partial_bytes() {
+  Lock lock(*this);
+  if (!_ready()) {
+    return 0;
+  }
+  validators_.load();
+  return validators_.partial_length();
+}
+
+bool MDIHelper::download(const char* name, uint16_t size) {
+  uint32_t key = IconPack::hash(name);
+  download::Request request;
+  request.fs = &icon_fs();
+  {
+    Lock lock(*this);
+    if (exists(name, size)) {
+      if (!_revalidation_due(name, size)) {
+        info("'%s' size %d already exists", name, size);
+        return true;
+      }
+      request.conditional = true;
+    }
+    validators_.load();
+    validators_.get(key, size, request.validator);
+    if (!request.conditional) {
+      request.length = validators_.partial(key, size);
+    }
   }
 
-  debug("Downloading '%s' size %d to '%s'", name, size, path.c_str());
+  // downloaded completely before it is appended to the pack, other tasks
+  // can use the icons meanwhile
+  debug("Downloading '%s' size %d to '%s'", name, size, DOWNLOAD_PATH);
 
-  File file = SPIFFS.open(path.c_str(), FILE_WRITE, true);
+  File file = _open_download(request.length);
   if (!file) {
-    error("Failed to open '%s' for writing", path.c_str());
+    error("Failed to open '%s' for writing", DOWNLOAD_PATH);
     return false;
   }
+  if (request.length > 0) {
+    info("Resuming '%s' size %d at %u bytes", name, size, request.length);
+  }
+
+  bool batch = client_ != nullptr;
+  if (!batch) begin_downloads();
+  if (base_url_.empty()) set_base_url(nullptr);
+  StaticString<256> url("%s%dx%d/%s.bmp%s", base_url_.c_str(), size, size,
+                        name, try_gzip_ ? ".gz" : "");
+  bool ret = client_->get(url.c_str(), file, &request);
+  if (!ret && try_gzip_ && client_->status() == 404) {
+    // the server has no gzipped icons, stop asking
+    info("no gzipped icons on the server");
+    try_gzip_ = false;
+    file = _open_download(request.length);
+    url.set("%s%dx%d/%s.bmp", base_url_.c_str(), size, size, name);
+    ret = file && client_->get(url.c_str(), file, &request);
+  }
+  if (!batch) end_downloads();
 
-  StaticString<256> url("%s%dx%d/%s.bmp", MDI_URL, size, size, name);
-  bool ret = download::download_file_https(
-      HOST, url.c_str(), file,
-      github_raw_cert::DigiCert_Global_Root_G2);
+  Lock lock(*this);
+  manifest_.load();
+  validators_.load();
+  IconPack* pack = nullptr;
+  if (ret && request.not_modified) {
+    info("'%s' size %d not modified", name, size);
+    validators_.set(key, size, request.validator, manifest_.clock());
+  } else if (ret) {
+    pack = _get_pack(size);
+    file = icon_fs().open(DOWNLOAD_PATH, FILE_READ);
+    ret = pack != nullptr && file && pack->add(name, file, request.length);
+    file.close();
+    if (ret) {
+      manifest_.touch(key, size, pack->find(name)->length);
+      validators_.set(key, size, request.validator, manifest_.clock());
+      if (request.conditional) {
+        replaced_icons_++;
+      }
+    }
+  } else if (!request.conditional && request.length > 0 &&
+             request.validator.strong()) {
+    // the next attempt continues where this one stopped
+    validators_.set(key, size, request.validator, manifest_.clock());
+    validators_.set_partial(key, size, request.length);
+    warning("Kept %u bytes of '%s' size %d", request.length, name, size);
+    return false;
+  }
+  validators_.set_partial(0, 0, 0);
+  icon_fs().remove(DOWNLOAD_PATH);
+  // a replaced icon leaves its old record, compacted with the download
+  // file gone
+  if (ret && pack != nullptr && pack->fragmented()) {
+    pack->compact();
+  }
   if (ret) {
     info("Downloaded '%s' size: %d", name, size);
     return true;
   } else {
     error("Failed to download '%s' size: %d", name, size);
-    SPIFFS.remove(path.c_str());
     return false;
   }
 }
 
 bool MDIHelper::download(const char* name) {
-  if (!spiffs_mounted_) {
-    error("SPIFFS not mounted");
-    return false;
-  }
-
   for (uint8_t i = 0; i < num_sizes_; ++i) {
     if (!download(name, sizes_[i])) {
       return false;
@@ -104,17 +351,21 @@ bool MDIHelper::download(const char* name) {
 }
 
 bool MDIHelper::exists(const char* name, uint16_t size) {
-  if (!spiffs_mounted_) {
-    error("SPIFFS not mounted");
+  Lock lock(*this);
+  if (!_ready()) {
     return false;
   }
-  auto path = _get_path(name, size);
-  return SPIFFS.exists(path.c_str());
+  uint32_t start = micros();
+  IconPack* pack = _get_pack(size);
+  bool ret = pack != nullptr && pack->find(name) != nullptr;
+  lookup_us_ += micros() - start;
+  lookup_count_++;
+  return ret;
 }
 
 bool MDIHelper::exists_all_sizes(const char* name) {
-  if (!spiffs_mounted_) {
-    error("SPIFFS not mounted");
+  Lock lock(*this);
+  if (!_ready()) {
     return false;
   }
   for (uint8_t i = 0; i < num_sizes_; ++i) {
@@ -126,77 +377,403 @@ bool MDIHelper::exists_all_sizes(const char* name) {
 }
 
 File MDIHelper::get_file(const char* name, uint16_t size) {
-  if (!spiffs_mounted_) {
-    error("SPIFFS not mounted");
+  Lock lock(*this);
+  if (!_ready()) {
     return File();
   }
 
-  if (!exists(name, size)) {
-    error("'%s' size %d does not exist", name, size);
+  uint32_t start = micros();
+  IconPack* pack = _get_pack(size);
+  File file = pack != nullptr ? pack->open(name) : File();
+  lookup_us_ += micros() - start;
+  lookup_count_++;
+  if (!file) {
+    debug("'%s' size %d does not exist", name, size);
+  }
+  return file;
+}
+
+File MDIHelper::open(const char* path, const char* mode) {
+  Lock lock(*this);
+  if (!_ready()) {
     return File();
   }
+  uint32_t start = micros();
+  File file = icon_fs().open(path, mode, strcmp(mode, FILE_READ) != 0);
+  lookup_us_ += micros() - start;
+  lookup_count_++;
+  return file;
+}
 
-  auto path = _get_path(name, size);
-  debug("Opening '%s'", path.c_str());
-  return SPIFFS.open(path.c_str(), FILE_READ);
+bool MDIHelper::remove_file(const char* path) {
+  Lock lock(*this);
+  if (!_ready()) {
+    return false;
+  }
+  debug("Removing '%s'", path);
+  return icon_fs().remove(path);
 }
 
 size_t MDIHelper::get_free_space() {
-  if (!spiffs_mounted_) {
-    error("SPIFFS not mounted");
+  Lock lock(*this);
+  if (!_ready()) {
     return 0;
   }
-  size_t free = SPIFFS.totalBytes() - SPIFFS.usedBytes();
+  size_t free = icon_storage().total_bytes() - icon_storage().used_bytes();
   debug("Free space: %d", free);
   return free;
 }
 
-bool MDIHelper::make_space(size_t size) {
-  if (!spiffs_mounted_) {
-    error("SPIFFS not mounted");
+bool MDIHelper::make_space(size_t size, const MDIName* keep,
+                           uint8_t num_keep) {
+  Lock lock(*this);
+  if (!_ready()) {
     return false;
   }
-  if (get_free_space() > size) {
+  size_t free = get_free_space();
+  if (free > size) {
     return true;
   }
-  info("Freeing space...");
-  File root = SPIFFS.open(FOLDER);
-  if (!root) {
-    error("Failed to open '%s'", FOLDER);
-    return false;
+  if (_drop_cache() > 0) {
+    free = get_free_space();
+    if (free > size) {
+      return true;
+    }
   }
-  if (!root.isDirectory()) {
-    error("'%s' is not a directory", FOLDER);
-    return false;
+  size_t needed = size - free;
+  info("Freeing %d bytes...", needed);
+  manifest_.load();
+  uint32_t keep_hashes[num_keep > 0 ? num_keep : 1];
+  for (uint8_t i = 0; i < num_keep; ++i) {
+    keep_hashes[i] = IconPack::hash(keep[i].c_str());
   }
+  auto kept = [&](uint32_t hash) {
+    return std::find(keep_hashes, keep_hashes + num_keep, hash) !=
+           keep_hashes + num_keep;
+  };
+
+  // least recently used icon of all sizes until the space is reclaimable,
+  // reclaimed by compaction
   uint16_t count = 0;
-  size_t size_before = SPIFFS.usedBytes();
-  while (get_free_space() < size) {
-    File file = root.openNextFile();
-    if (!file) {
-      error("Failed to open next file");
-      return false;
+  uint32_t evicted_bytes = 0;
+  uint32_t newest_evicted = 0;
+  uint8_t failed_packs = 0;  // bit per size, not writable
+  while (_dead_bytes() < needed) {
+    IconPack* lru_pack = nullptr;
+    uint8_t lru_idx = 0;
+    uint32_t lru_hash = 0;
+    uint32_t lru_used = UINT32_MAX;
+    uint32_t lru_bytes = 0;
+    for (uint8_t i = 0; i < num_sizes_; ++i) {
+      if (failed_packs & (1 << i)) continue;
+      IconPack* pack = _get_pack(sizes_[i]);
+      for (uint16_t j = 0; pack != nullptr && j < pack->count(); ++j) {
+        const IconPack::Entry& entry = pack->entry(j);
+        uint32_t used = manifest_.last_used(entry.hash, pack->size());
+        if (used < lru_used && !kept(entry.hash)) {
+          lru_pack = pack;
+          lru_idx = i;
+          lru_hash = entry.hash;
+          lru_used = used;
+          lru_bytes = entry.length;
+        }
+      }
     }
-    size_t len = strlen(file.path());
-    char path[len + 1];
-    strncpy(path, file.path(), len + 1);
-    file.close();
-    SPIFFS.remove(path);
+    if (lru_pack == nullptr) {
+      warning("Only icons in use left");
+      break;
+    }
+    if (!lru_pack->remove(lru_hash)) {
+      // the entry would be picked again
+      warning("Failed to remove from size %u pack", lru_pack->size());
+      failed_packs |= 1 << lru_idx;
+      continue;
+    }
+    evicted_bytes += lru_bytes;
+    manifest_.remove(lru_hash, lru_pack->size());
+    validators_.load();
+    validators_.remove(lru_hash, lru_pack->size());
+    newest_evicted = lru_used;
     count++;
-    debug("Removed '%s'", path);
-    delay(10);
   }
-  info("Removed %d files, freed %d bytes", count,
-       size_before - SPIFFS.usedBytes());
-  return true;
+
+  // icons in use that would have gone without keep
+  uint16_t avoided = 0;
+  for (uint8_t i = 0; count > 0 && i < num_sizes_; ++i) {
+    IconPack* pack = _get_pack(sizes_[i]);
+    for (uint16_t j = 0; pack != nullptr && j < pack->count(); ++j) {
+      const IconPack::Entry& entry = pack->entry(j);
+      if (kept(entry.hash) &&
+          manifest_.last_used(entry.hash, pack->size()) <= newest_evicted) {
+        avoided++;
+      }
+    }
+  }
+
+  size_t size_before = icon_storage().used_bytes();
+  for (auto& pack : packs_) {
+    if (pack.dead_bytes() == 0 || pack.compact()) {
+      continue;
+    }
+    // not enough space left to rewrite the pack, it is smaller without the
+    // icons that are not in use
+    uint16_t dropped = 0;
+    validators_.load();
+    for (uint16_t j = pack.count(); j-- > 0;) {
+      uint32_t hash = pack.entry(j).hash;
+      if (kept(hash)) continue;
+      if (!pack.remove(hash)) break;
+      manifest_.remove(hash, pack.size());
+      validators_.remove(hash, pack.size());
+      dropped++;
+    }
+    warning("Size %d: dropped %d icons not in use to compact", pack.size(),
+            dropped);
+    count += dropped;
+    if (dropped == 0 || !pack.compact()) {
+      // icons in use stay, the dead bytes go with a later compaction
+      warning("Size %d: left uncompacted", pack.size());
+    }
+  }
+  manifest_.add_evictions(count, avoided);
+  info("Evicted %d icons (%u bytes), %d re-downloads avoided, freed %d "
+       "bytes",
+       count, evicted_bytes, avoided,
+       size_before - icon_storage().used_bytes());
+  info("Total: %u evicted, %u re-downloads avoided", manifest_.evictions(),
+       manifest_.avoided());
+  return get_free_space() > size;
+}
+
+void MDIHelper::mark_used(const char* name, uint16_t size) {
+  mark_used(IconPack::hash(name), size);
+}
+
+void MDIHelper::mark_used(uint32_t hash, uint16_t size) {
+  Lock lock(*this);
+  // icons may be drawn from the cache without storage
+  if (!mounted_ && session_count_ == 0) {
+    return;
+  }
+  IconPack* pack = _get_pack(size);
+  const IconPack::Entry* entry =
+      pack != nullptr ? pack->find(hash) : nullptr;
+  if (entry != nullptr) {
+    manifest_.load();
+    manifest_.touch(entry->hash, size, entry->length);
+  }
 }
 
 bool MDIHelper::remove(const char* name, uint16_t size) {
-  if (!spiffs_mounted_) {
-    error("SPIFFS not mounted");
+  Lock lock(*this);
+  if (!_ready()) {
+    return false;
+  }
+  cache_.invalidate(name, size);
+  IconPack* pack = _get_pack(size);
+  if (pack == nullptr) {
+    return false;
+  }
+  debug("Removing '%s' size %d", name, size);
+  if (!pack->remove(name)) {
     return false;
   }
-  auto path = _get_path(name, size);
-  debug("Removing '%s'", path.c_str());
-  return SPIFFS.remove(path.c_str());
+  manifest_.load();
+  manifest_.remove(IconPack::hash(name), size);
+  validators_.load();
+  validators_.remove(IconPack::hash(name), size);
+  if (pack->fragmented()) {
+    pack->compact();
+  }
+  return true;
+}
+
+bool MDIHelper::check_connection() {
+  return download::check_connection(HOST, TEST_URL,
+                                    github_raw_cert::DigiCert_Global_Root_G2);
+}
+
+#if defined(HOME_BUTTONS_MDI_BENCHMARK)
+StaticString<MAX_PATH_LEN> MDIHelper::_get_path(const char* name,
+                                                uint16_t size) {
+  return StaticString<MAX_PATH_LEN>("%s/%d/%s.bmp", FOLDER, size, name);
+}
+
+void MDIHelper::benchmark_lookups(uint16_t num_icons) {
+  Lock lock(*this);
+  static constexpr uint16_t SIZE = 1;  // not used by any device
+  if (!begin()) {
+    return;
+  }
+  IconPack pack;
+  pack.load(SIZE);
+  uint8_t data[512] = {};
+  for (uint16_t i = 0; i < num_icons; i++) {
+    StaticString<16> name("bench-%u", i);
+    auto path = _get_path(name.c_str(), SIZE);
+    File file = icon_fs().open(path.c_str(), FILE_WRITE, true);
+    file.write(data, sizeof(data));
+    file.close();
+    file = icon_fs().open(path.c_str(), FILE_READ);
+    pack.add(name.c_str(), file, file.size());
+  }
+
+  // hits, then misses as for icons not downloaded yet
+  uint32_t files_us[2] = {};
+  uint32_t pack_us[2] = {};
+  for (uint8_t miss = 0; miss < 2; miss++) {
+    for (uint16_t i = 0; i < num_icons; i++) {
+      StaticString<16> name(miss ? "none-%u" : "bench-%u", i);
+      auto path = _get_path(name.c_str(), SIZE);
+      uint32_t start = micros();
+      if (icon_fs().exists(path.c_str())) {
+        icon_fs().open(path.c_str(), FILE_READ).close();
+      }
+      files_us[miss] += micros() - start;
+      start = micros();
+      if (pack.find(name.c_str()) != nullptr) {
+        pack.open(name.c_str()).close();
+      }
+      pack_us[miss] += micros() - start;
+    }
+  }
+  info("%u icons, per lookup: files %u us (miss %u us), pack %u us "
+       "(miss %u us)",
+       num_icons, files_us[0] / num_icons, files_us[1] / num_icons,
+       pack_us[0] / num_icons, pack_us[1] / num_icons);
+
+  for (uint16_t i = 0; i < num_icons; i++) {
+    StaticString<16> name("bench-%u", i);
+    icon_fs().remove(_get_path(name.c_str(), SIZE).c_str());
+  }
+  pack.erase();
+  end();
+}
+
+void MDIHelper::benchmark_storage() {
+  static constexpr char FILL_FOLDER[] = "/bench/fill";
+  static constexpr char ICON_FOLDER[] = "/bench/icon";
+  static constexpr uint8_t FILL_LEVELS[] = {0, 25, 50, 75, 90};  // %
+  static constexpr uint16_t NUM_ICONS = 20;  // per fill level
+  static constexpr uint8_t FILL_CHUNKS = 8;  // per dummy file
+  Lock lock(*this);
+  if (!begin()) {
+    return;
+  }
+  IconStorage& storage = icon_storage();
+  uint8_t data[512] = {};  // a 64x64 icon
+  uint16_t num_fill = 0;
+  for (uint8_t level : FILL_LEVELS) {
+    size_t target = storage.total_bytes() / 100 * level;
+    bool full = false;
+    while (!full && storage.used_bytes() < target) {
+      StaticString<32> path("%s/%u", FILL_FOLDER, num_fill++);
+      File file = icon_fs().open(path.c_str(), FILE_WRITE, true);
+      for (uint8_t i = 0; i < FILL_CHUNKS && !full; i++) {
+        full = file.write(data, sizeof(data)) != sizeof(data);
+      }
+    }
+
+    uint32_t write_us = 0;
+    uint32_t open_us = 0;
+    uint32_t read_us = 0;
+    for (uint16_t i = 0; i < NUM_ICONS; i++) {
+      StaticString<32> path("%s/%u", ICON_FOLDER, i);
+      uint32_t start = micros();
+      File file = icon_fs().open(path.c_str(), FILE_WRITE, true);
+      file.write(data, sizeof(data));
+      file.close();
+      write_us += micros() - start;
+    }
+    for (uint16_t i = 0; i < NUM_ICONS; i++) {
+      StaticString<32> path("%s/%u", ICON_FOLDER, i);
+      uint32_t start = micros();
+      File file = icon_fs().open(path.c_str(), FILE_READ);
+      open_us += micros() - start;
+      start = micros();
+      file.read(data, sizeof(data));
+      file.close();
+      read_us += micros() - start;
+    }
+    info("%s %u%% full: open %u us, read %u us, write %u us", storage.name(),
+         storage.used_bytes() * 100 / storage.total_bytes(),
+         open_us / NUM_ICONS, read_us / NUM_ICONS, write_us / NUM_ICONS);
+    for (uint16_t i = 0; i < NUM_ICONS; i++) {
+      icon_fs().remove(StaticString<32>("%s/%u", ICON_FOLDER, i).c_str());
+    }
+  }
+
+  for (uint16_t i = 0; i < num_fill; i++) {
+    icon_fs().remove(StaticString<32>("%s/%u", FILL_FOLDER, i).c_str());
+  }
+  end();
+}
+#endif
+
+#if defined(HOME_BUTTONS_DOWNLOAD_BENCHMARK)
+void MDIHelper::benchmark_downloads() {
+  static constexpr char BENCH_PATH[] = "/mdi/bench.tmp";
+  static constexpr const char* ICONS[] = {"lightbulb", "fan",    "television",
+                                          "blinds",    "garage", "lock"};
+  struct Config {
+    size_t buffer_size;
+    bool overlap_writes;
+    bool keep_alive;
+  };
+  // the first one is download_file_https()
+  static constexpr Config CONFIGS[] = {
+      {1024, false, false}, {512, false, true},  {512, true, true},
+      {1024, false, true},  {1024, true, true},  {4096, false, true},
+      {4096, true, true}};
+
+  Lock lock(*this);
+  if (!begin()) {
+    return;
+  }
+  if (base_url_.empty()) set_base_url(nullptr);
+  // a local test server has a self-signed certificate
+  const char* certificate = strcmp(base_url_.c_str(), MDI_URL) == 0
+                                ? github_raw_cert::DigiCert_Global_Root_G2
+                                : nullptr;
+  info("download benchmark: %s", base_url_.c_str());
+  for (const Config& config : CONFIGS) {
+    download::Client client(certificate, config.buffer_size,
+                            config.overlap_writes);
+    uint16_t failed = 0;
+    for (uint8_t s = 0; s < num_sizes_; s++) {
+      for (const char* name : ICONS) {
+        StaticString<256> url("%s%dx%d/%s.bmp", base_url_.c_str(), sizes_[s],
+                              sizes_[s], name);
+        File file = icon_fs().open(BENCH_PATH, FILE_WRITE, true);
+        uint32_t bytes = client.bytes();
+        uint32_t time_ms = client.time_ms();
+        uint32_t connect_ms = client.connect_ms();
+        uint32_t write_us = client.write_us();
+        if (!client.get(url.c_str(), file)) {
+          failed++;
+        }
+        if (!config.keep_alive) {
+          client.end();
+        }
+        debug("'%s' size %u: %u bytes in %u ms, connect %u ms, write %u us",
+              name, sizes_[s], client.bytes() - bytes,
+              client.time_ms() - time_ms, client.connect_ms() - connect_ms,
+              client.write_us() - write_us);
+      }
+    }
+    client.end();
+    uint16_t requests = std::max<uint16_t>(client.requests(), 1);
+    uint16_t connects = std::max<uint16_t>(client.connects(), 1);
+    info("%u B buffer, %s writes, %s: %u KB/s, %u failed",
+         config.buffer_size, config.overlap_writes ? "overlapped" : "sync",
+         config.keep_alive ? "keep-alive" : "connection per icon",
+         client.bytes() * 1000 / 1024 / std::max<uint32_t>(client.time_ms(), 1),
+         failed);
+    info("  %u connections, %u ms each, per icon %u ms, write %u us",
+         client.connects(), client.connect_ms() / connects,
+         client.time_ms() / requests, client.write_us() / requests);
+  }
+  icon_fs().remove(BENCH_PATH);
+  end();
 }
+#endif
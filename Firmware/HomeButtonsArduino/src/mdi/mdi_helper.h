@@ -1,36 +1,171 @@
 #ifndef HOMEBUTTONS_MDI_HELPER_H
 #define HOMEBUTTONS_MDI_HELPER_H
 
-#include <SPIFFS.h>
+#include <FS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 
+#include "config.h"
 #include "logger.h"
 #include "static_string.h"
+#include "glyph_font.h"
+#include "icon_cache.h"
+#include "icon_manifest.h"
+#include "icon_pack.h"
+#include "icon_storage.h"
+#include "icon_validators.h"
+#include "types.h"
+
+namespace download {
+class Client;
+}
 
 static constexpr uint8_t MAX_NUM_SIZES = 3;
+// one more for sizes not added with add_size(), e.g. the factory test
+static constexpr uint8_t MAX_NUM_PACKS = MAX_NUM_SIZES + 1;
 
 static constexpr size_t MAX_PATH_LEN = 56;
 
+// derived files on the icon storage (e.g. pre-rendered frames), rebuilt
+// when missing and dropped first by MDIHelper::make_space()
+static constexpr char CACHE_FOLDER[] = "/cache";
+
+// Used from the display and the icon download tasks, public methods are
+// serialized by a recursive mutex. The decoded icon cache is only used by the
+// display.
 class MDIHelper : public Logger {
  public:
-  MDIHelper() : Logger("MDI") {}
+  // Keeps storage available for its lifetime, e.g. a whole frame render.
+  // Storage is mounted lazily on first file access and unmounted at the end
+  // of the outermost session, unless held by begin().
+  class Session {
+   public:
+    explicit Session(MDIHelper& mdi);
+    ~Session();
+    Session(const Session&) = delete;
+    Session& operator=(const Session&) = delete;
+
+   private:
+    MDIHelper& mdi_;
+    uint32_t start_mounts_;
+    uint32_t start_lookups_;
+    uint32_t start_lookup_us_;
+  };
+
+  MDIHelper() : Logger("MDI"), cache_(MDI_CACHE_BUDGET) {}
+  // begin() / end() calls are counted, storage stays mounted until the last
+  // end()
   bool begin();
   void add_size(uint16_t size);
+  // Icons are downloaded from <url><size>x<size>/<name>.bmp, empty for the
+  // default repository. Other servers, e.g. a mirror on the local network,
+  // are asked for gzipped icons (<name>.bmp.gz) first.
+  void set_base_url(const char* url);
+  // Downloads between begin_downloads() and end_downloads() share one
+  // connection to the icon server.
+  void begin_downloads();
+  void end_downloads();
+  // Icons in the glyph font (/glyphs.bin, see GlyphFont) are drawn from
+  // their outlines at any size and never downloaded.
+  bool has_glyph(const char* name);
+  // draws into the bitmap, false if not in the glyph font
+  bool render_glyph(const char* name, IconBitmap& bitmap);
+  // false if a download failed without ever reaching the icon server
+  bool server_reachable() const;
+  // icons replaced by a newer version since begin_downloads()
+  uint16_t replaced_icons() const { return replaced_icons_; }
+  // Downloads a missing icon or checks a stored one with a conditional
+  // request once MDI_REVALIDATE_INTERVAL wakeups passed since the last
+  // check. An interrupted download is kept and resumed by the next call.
   bool download(const char* name, uint16_t size);
   bool download(const char* name);
-  bool check_connection();
+  // true if download() has something to do, never for icons in the glyph
+  // font
+  bool needs_download(const char* name, uint16_t size);
+  bool needs_download(const char* name);
+  // bytes of an interrupted download kept for resuming, 0 if none
+  uint32_t partial_bytes();
   bool exists(const char* name, uint16_t size);
   bool exists_all_sizes(const char* name);
   File get_file(const char* name, uint16_t size);
+  // other files on the icon storage, e.g. the main page display list
+  File open(const char* path, const char* mode = FILE_READ);
+  bool remove_file(const char* path);
   size_t get_free_space();
-  bool make_space(size_t size);
+  // Drops the files in CACHE_FOLDER, then evicts least recently used icons
+  // until size bytes are free. Icons in keep (e.g. on the current labels)
+  // are never evicted.
+  bool make_space(size_t size, const MDIName* keep = nullptr,
+                  uint8_t num_keep = 0);
   bool remove(const char* name, uint16_t size);
   void end();
+  IconCache& cache() { return cache_; }
+  // records in the manifest that the icon was drawn
+  void mark_used(const char* name, uint16_t size);
+  void mark_used(uint32_t hash, uint16_t size);  // IconPack::hash()
+  // Factory test only: fetches a fixed icon from the default repository
+  // with a one-shot connection. Icon downloads report reachability through
+  // server_reachable() instead.
+  bool check_connection();
+#if defined(HOME_BUTTONS_MDI_BENCHMARK)
+  // compares lookups of num_icons dummy icons stored as single files and in
+  // a pack
+  void benchmark_lookups(uint16_t num_icons);
+  // open, read and write latency of icon sized files in the icon storage
+  // filled to several levels with dummy files
+  void benchmark_storage();
+#endif
+#if defined(HOME_BUTTONS_DOWNLOAD_BENCHMARK)
+  // Downloads a fixed icon set from the server set with set_base_url() with
+  // a connection per icon and over one connection with several buffer sizes,
+  // with and without overlapped writes. Logs KB/s, connect (TLS handshake)
+  // time and flash write time.
+  void benchmark_downloads();
+#endif
+
+  uint32_t mount_count() const { return mount_count_; }
 
  private:
-  bool spiffs_mounted_ = false;
+  class Lock {
+   public:
+    explicit Lock(MDIHelper& mdi) : mdi_(mdi) {
+      xSemaphoreTakeRecursive(mdi_.mutex_, portMAX_DELAY);
+    }
+    ~Lock() { xSemaphoreGiveRecursive(mdi_.mutex_); }
+
+   private:
+    MDIHelper& mdi_;
+  };
+
+  SemaphoreHandle_t mutex_ = xSemaphoreCreateRecursiveMutex();
+  bool mounted_ = false;
+  uint8_t begin_count_ = 0;
+  uint8_t session_count_ = 0;
+  uint32_t mount_count_ = 0;
+  uint32_t lookup_count_ = 0;
+  uint32_t lookup_us_ = 0;
+  IconCache cache_;
+  GlyphFont glyphs_;
   uint16_t sizes_[MAX_NUM_SIZES] = {0};
   uint8_t num_sizes_ = 0;
+  IconPack packs_[MAX_NUM_PACKS];
+  IconManifest manifest_;
+  IconValidators validators_;
+  uint16_t replaced_icons_ = 0;
+  download::Client* client_ = nullptr;
+  StaticString<ICON_URL_MAXLEN> base_url_;
+  bool try_gzip_ = false;
+  IconPack* _get_pack(uint16_t size);
+  size_t _dead_bytes();
+  size_t _drop_cache();
+  bool _revalidation_due(const char* name, uint16_t size);
+  File _open_download(uint32_t& length);
+#if defined(HOME_BUTTONS_MDI_BENCHMARK)
   StaticString<MAX_PATH_LEN> _get_path(const char* name, uint16_t size);
+#endif
+  bool _mount();
+  void _unmount();
+  bool _ready();
 };
 
 #endif
@@ -0,0 +1,165 @@
+#include "rasterizer.h"
+
+#include "config.h"
+
+// flattening tolerance, 1/4 pixel
+static constexpr int32_t TOLERANCE = Rasterizer::ONE / 4;
+static constexpr uint32_t MAX_SEGMENTS = 32;  // per curve
+
+// Segments so that the distance to the curve stays within TOLERANCE, from
+// n^2 >= k * dd / TOLERANCE with dd the largest second difference of the
+// control points (k = 1/4 for quadratic, 3/4 for cubic curves).
+static uint32_t segments(uint32_t n2) {
+  uint32_t n = 1;
+  while (n * n < n2 && n < MAX_SEGMENTS) n++;
+  return n;
+}
+
+static uint32_t second_diff(int32_t a, int32_t b, int32_t c) {
+  return abs(a - 2 * b + c);
+}
+
+// first pixel with its center at or right of x
+static int32_t first_pixel(int32_t x) {
+  int32_t a = x - Rasterizer::ONE / 2;
+  return a >= 0 ? (a + Rasterizer::ONE - 1) / Rasterizer::ONE
+                : a / Rasterizer::ONE;
+}
+
+Rasterizer::~Rasterizer() { free(edges_); }
+
+void Rasterizer::move_to(int32_t x, int32_t y) {
+  _close();
+  start_x_ = x_ = x;
+  start_y_ = y_ = y;
+}
+
+void Rasterizer::line_to(int32_t x, int32_t y) {
+  _edge(x_, y_, x, y);
+  x_ = x;
+  y_ = y;
+}
+
+void Rasterizer::quad_to(int32_t cx, int32_t cy, int32_t x, int32_t y) {
+  uint32_t dd = std::max(second_diff(x_, cx, x), second_diff(y_, cy, y));
+  int64_t n = segments(dd / (4 * TOLERANCE));
+  int32_t x0 = x_;
+  int32_t y0 = y_;
+  for (int64_t i = 1; i < n; i++) {
+    int64_t t = n - i;
+    line_to((t * t * x0 + 2 * t * i * cx + i * i * x) / (n * n),
+            (t * t * y0 + 2 * t * i * cy + i * i * y) / (n * n));
+  }
+  line_to(x, y);
+}
+
+void Rasterizer::cubic_to(int32_t cx1, int32_t cy1, int32_t cx2,
+                          int32_t cy2, int32_t x, int32_t y) {
+  uint32_t dd = std::max(
+      std::max(second_diff(x_, cx1, cx2), second_diff(cx1, cx2, x)),
+      std::max(second_diff(y_, cy1, cy2), second_diff(cy1, cy2, y)));
+  int64_t n = segments(3 * dd / (4 * TOLERANCE));
+  int32_t x0 = x_;
+  int32_t y0 = y_;
+  int64_t n3 = n * n * n;
+  for (int64_t i = 1; i < n; i++) {
+    int64_t t = n - i;
+    int64_t a = t * t * t;
+    int64_t b = 3 * t * t * i;
+    int64_t c = 3 * t * i * i;
+    int64_t d = i * i * i;
+    line_to((a * x0 + b * cx1 + c * cx2 + d * x) / n3,
+            (a * y0 + b * cy1 + c * cy2 + d * y) / n3);
+  }
+  line_to(x, y);
+}
+
+bool Rasterizer::fill(IconBitmap& bitmap) {
+  _close();
+  bool ok = !overflow_;
+  if (!ok) {
+    error("outlines dropped after %u edges", count_);
+  }
+  Crossing* crossings = nullptr;
+  if (ok && count_ > 0) {
+    crossings = static_cast<Crossing*>(malloc(count_ * sizeof(Crossing)));
+    if (crossings == nullptr) {
+      error("failed to allocate %u crossings", count_);
+      ok = false;
+    }
+  }
+  uint16_t stride = (bitmap.width + 7) / 8;
+  for (uint16_t row = 0; ok && row < bitmap.height; row++) {
+    // edges crossing the centers of the row, sorted by x
+    int32_t y = row * ONE + ONE / 2;
+    uint16_t num = 0;
+    for (uint16_t i = 0; i < count_; i++) {
+      const Edge& edge = edges_[i];
+      if (y < edge.y0 || y >= edge.y1) continue;
+      int32_t x = edge.x0 + static_cast<int64_t>(y - edge.y0) *
+                                (edge.x1 - edge.x0) / (edge.y1 - edge.y0);
+      uint16_t j = num++;
+      for (; j > 0 && crossings[j - 1].x > x; j--) {
+        crossings[j] = crossings[j - 1];
+      }
+      crossings[j] = {x, edge.dir};
+    }
+
+    uint8_t* line = bitmap.data + row * stride;
+    int32_t winding = 0;
+    for (uint16_t i = 0; i + 1 < num; i++) {
+      winding += crossings[i].dir;
+      if (winding == 0) continue;
+      int32_t from = std::max(first_pixel(crossings[i].x), 0);
+      int32_t to = std::min(first_pixel(crossings[i + 1].x),
+                            static_cast<int32_t>(bitmap.width));
+      for (int32_t px = from; px < to; px++) {
+        line[px / 8] |= 0x80 >> (px % 8);
+      }
+    }
+  }
+  free(crossings);
+  _reset();
+  return ok;
+}
+
+void Rasterizer::_close() {
+  if (x_ != start_x_ || y_ != start_y_) {
+    line_to(start_x_, start_y_);
+  }
+}
+
+void Rasterizer::_edge(int32_t x0, int32_t y0, int32_t x1, int32_t y1) {
+  if (y0 == y1 || overflow_) {
+    return;  // horizontal edges cross no row centers
+  }
+  if (count_ == capacity_) {
+    if (capacity_ >= MDI_GLYPH_MAX_EDGES) {
+      overflow_ = true;
+      return;
+    }
+    uint16_t capacity = std::min<uint16_t>(
+        capacity_ > 0 ? 2 * capacity_ : 64, MDI_GLYPH_MAX_EDGES);
+    Edge* grown =
+        static_cast<Edge*>(realloc(edges_, capacity * sizeof(Edge)));
+    if (grown == nullptr) {
+      overflow_ = true;
+      return;
+    }
+    edges_ = grown;
+    capacity_ = capacity;
+  }
+  if (y0 < y1) {
+    edges_[count_++] = {x0, y0, x1, y1, 1};
+  } else {
+    edges_[count_++] = {x1, y1, x0, y0, -1};
+  }
+}
+
+void Rasterizer::_reset() {
+  free(edges_);
+  edges_ = nullptr;
+  count_ = capacity_ = 0;
+  overflow_ = false;
+  start_x_ = start_y_ = x_ = y_ = 0;
+}
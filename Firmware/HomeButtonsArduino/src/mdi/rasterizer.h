@@ -0,0 +1,58 @@
+#ifndef HOMEBUTTONS_RASTERIZER_H
+#define HOMEBUTTONS_RASTERIZER_H
+
+#include "icon_cache.h"
+#include "logger.h"
+
+// Fills outlines with the nonzero winding rule into a 1-bpp bitmap. A pixel
+// is set if its center is inside, there is no antialiasing on the e-paper
+// anyway. Curves are flattened into line segments. Integer math only, the
+// ESP32-S2 has no FPU. Coordinates are in 1/ONE pixel.
+class Rasterizer : public Logger {
+ public:
+  static constexpr int32_t ONE = 256;
+
+  Rasterizer() : Logger("Raster") {}
+  Rasterizer(const Rasterizer&) = delete;
+  ~Rasterizer();
+
+  // starts a new contour, the previous one is closed
+  void move_to(int32_t x, int32_t y);
+  void line_to(int32_t x, int32_t y);
+  void quad_to(int32_t cx, int32_t cy, int32_t x, int32_t y);
+  void cubic_to(int32_t cx1, int32_t cy1, int32_t cx2, int32_t cy2, int32_t x,
+                int32_t y);
+  // Sets the pixels inside the outlines, the bitmap is not cleared. False if
+  // the outlines had more than MDI_GLYPH_MAX_EDGES segments. The outlines are
+  // reset either way.
+  bool fill(IconBitmap& bitmap);
+
+ private:
+  struct Edge {
+    int32_t x0;
+    int32_t y0;  // top, y0 < y1
+    int32_t x1;
+    int32_t y1;
+    int32_t dir;  // +1 downwards, -1 upwards
+  };
+
+  struct Crossing {
+    int32_t x;
+    int32_t dir;
+  };
+
+  Edge* edges_ = nullptr;
+  uint16_t count_ = 0;
+  uint16_t capacity_ = 0;
+  bool overflow_ = false;
+  int32_t start_x_ = 0;
+  int32_t start_y_ = 0;
+  int32_t x_ = 0;
+  int32_t y_ = 0;
+
+  void _close();
+  void _edge(int32_t x0, int32_t y0, int32_t x1, int32_t y1);
+  void _reset();
+};
+
+#endif  // HOMEBUTTONS_RASTERIZER_H
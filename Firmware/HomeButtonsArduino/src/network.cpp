@@ -239,10 +239,21 @@ void Network::disconnect(bool erase) {
 }
 
 void Network::update() {
+  uint32_t now = millis();
+  if (last_update_time_ > 0) {
+    max_update_gap_ = std::max(max_update_gap_, now - last_update_time_);
+  }
+  last_update_time_ = now;
   mqtt_client_.loop();
   loop();
 }
 
+uint32_t Network::take_max_update_gap() {
+  uint32_t gap = max_update_gap_;
+  max_update_gap_ = 0;
+  return gap;
+}
+
 void Network::setup() { network_task_handle_ = xTaskGetCurrentTaskHandle(); }
 
 Network::State Network::get_state() { return state_; }
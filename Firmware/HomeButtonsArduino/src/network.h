@@ -125,6 +125,8 @@ class Network : public NetworkStateMachine, public Logger {
   void setup();  // Warning: must be called from same task (thread) as update()
 
   State get_state();
+  // longest time between two update() calls (MQTT loop) since the last call
+  uint32_t take_max_update_gap();
 
   IPAddress get_ip() { return WiFi.localIP(); }
 
@@ -143,6 +145,8 @@ class Network : public NetworkStateMachine, public Logger {
   State state_ = State::DISCONNECTED;
   Command command_ = Command::NONE;
   uint32_t cmd_connect_time_ = 0;
+  uint32_t last_update_time_ = 0;
+  uint32_t max_update_gap_ = 0;
   bool erase_ = false;
 
   DeviceState &device_state_;
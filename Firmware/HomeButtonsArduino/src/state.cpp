@@ -20,6 +20,7 @@ void DeviceState::save_user() {
   preferences_.putBool("use_f", user_preferences_.use_fahrenheit);
   preferences_.putUInt("led_am_br", user_preferences_.led_amb_bright);
   preferences_.putString("btn_conf", user_preferences_.btn_conf_string.c_str());
+  preferences_.putString("icon_url", user_preferences_.icon_url.c_str());
   preferences_.putString("ssid", user_preferences_.network.ssid.c_str());
   preferences_.putString(
       "sta_ip",
@@ -68,6 +69,7 @@ void DeviceState::load_user() {
 
   _load_to_static_string(user_preferences_.btn_conf_string, "btn_conf",
                          BTN_CONF_DFLT);
+  _load_to_static_string(user_preferences_.icon_url, "icon_url", "");
 
   _load_to_static_string(user_preferences_.network.ssid, "ssid", "");
   _load_to_ip_address(user_preferences_.network.static_ip, "sta_ip", "0.0.0.0");
@@ -37,6 +37,7 @@ class DeviceState : public Logger {
     bool use_fahrenheit = false;
     uint8_t led_amb_bright = 0;  // 0-100
     BtnConfString btn_conf_string;
+    IconURL icon_url;  // empty for the default icon repository
 
     StaticIPConfig network;
 
@@ -163,6 +164,10 @@ class DeviceState : public Logger {
     }
   }
 
+  void set_icon_url(const IconURL& icon_url) {
+    user_preferences_.icon_url = icon_url;
+  }
+
   void save_user();
   void load_user();
   void clear_user();
@@ -91,6 +91,10 @@ TopicType TopicHelper::t_disp_msg_state() const {
   return t_common() + "disp_msg";
 }
 
+TopicType TopicHelper::t_icon_prefetch_cmd() const {
+  return t_cmd() + "icon_prefetch";
+}
+
 TopicType TopicHelper::t_schedule_wakeup_cmd() const {
   return t_cmd() + "schedule_wakeup";
 }
@@ -28,6 +28,7 @@ class TopicHelper {
   TopicType t_awake_mode_avlb() const;
   TopicType t_disp_msg_cmd() const;
   TopicType t_disp_msg_state() const;
+  TopicType t_icon_prefetch_cmd() const;
   TopicType t_schedule_wakeup_cmd() const;
   TopicType t_schedule_wakeup_state() const;
   TopicType t_led_amb_bright_cmd() const;
@@ -16,6 +16,7 @@ using ButtonLabel = StaticString<BTN_LABEL_MAXLEN>;
 using MDIName = StaticString<48>;
 using UserMessage = StaticString<USER_MSG_MAXLEN>;
 using BtnConfString = StaticString<16>;
+using IconURL = StaticString<ICON_URL_MAXLEN>;
 
 using TouchActionString = StaticString<16>;
 using ClickActionString = StaticString<16>;
@@ -4,6 +4,16 @@
 #include <IPAddress.h>
 #include "static_string.h"
 
+// FNV-1a, pass the previous hash to continue over several buffers
+inline uint32_t fnv1a(const void* data, size_t len,
+                      uint32_t hash = 2166136261UL) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < len; i++) {
+    hash = (hash ^ bytes[i]) * 16777619UL;
+  }
+  return hash;
+}
+
 inline StaticString<15> ip_address_to_static_string(
     const IPAddress& ip_address) {
   return StaticString<15>("%u.%u.%u.%u", ip_address[0], ip_address[1],
@@ -0,0 +1,205 @@
+// Renders every DisplayPage of one model off-screen and reports the render
+// time per page. Built and driven by host_render.py, see there for usage.
+//
+// host_render <out_dir> [--fs <dir>] [--repeat <n>] [--verbose]
+//
+// Writes <out_dir>/<page>.pbm and prints one line per page to stdout:
+// <page> <cold_us> <warm_us> <present_us>
+// cold: first render (empty icon cache), warm: fastest of the repeats,
+// present: transfer to the controller and (in-memory) refresh.
+// The last line, info_live, is a partial refresh of a changed info value.
+// The repeats draw from the stored display list and frame cache, a repeat
+// that shows a different image is written to <out_dir>/<page>.warm.pbm and
+// fails.
+
+#include <SPIFFS.h>
+#include <esp_log.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "config.h"
+#include "display/display.h"
+#include "hardware.h"
+#include "mdi/mdi_helper.h"
+#include "state.h"
+
+struct Page {
+  const char* name;
+  void (*show)(Display& display);
+};
+
+static const Page PAGES[] = {
+    {"main", [](Display& d) { d.disp_main(); }},
+    {"info", [](Display& d) { d.disp_info(); }},
+    {"device_info", [](Display& d) { d.disp_device_info(); }},
+    {"message", [](Display& d) { d.disp_message("Hello\nfrom the\nhost!"); }},
+    {"message_large",
+     [](Display& d) { d.disp_message_large("Washer\nDONE"); }},
+    {"error", [](Display& d) { d.disp_error("MQTT\nerror"); }},
+    {"welcome", [](Display& d) { d.disp_welcome(); }},
+    {"settings", [](Display& d) { d.disp_settings(); }},
+    {"ap_config", [](Display& d) { d.disp_ap_config(); }},
+    {"web_config", [](Display& d) { d.disp_web_config(); }},
+    {"test", [](Display& d) { d.disp_test("Test", "alien", 64); }},
+};
+
+#if defined(HOME_BUTTONS_MINI)
+// icons only
+static const char* LABELS[] = {"mdi:lightbulb", "mdi:fan", "mdi:television",
+                               "mdi:blinds"};
+#else
+// mix of icons, text, mixed labels and labels that need trimming
+static const char* LABELS[] = {
+    "mdi:lightbulb", "Lights",  "mdi:fan Fan",
+    "Living Room Ceiling Lamp", "_Small",  "mdi:television TV",
+    "mdi:blinds",    "Scene 1", "mdi:garage Garage",
+};
+#endif
+
+static void setup_state(HardwareDefinition& hw, DeviceState& state) {
+  // model name and unique ID are derived in HardwareDefinition::begin(),
+  // which needs the real hardware - they stay empty on the host
+  hw.set_serial_number("A1230001");
+  hw.set_random_id("a1b2c3");
+  hw.set_model_id(SW_MODEL_ID);
+  hw.set_hw_version("2.3");
+  hw.EINK_CS = 1;
+  hw.EINK_DC = 2;
+  hw.EINK_RST = 3;
+  hw.EINK_BUSY = 4;
+  state.load_all(hw);
+
+  state.set_device_name(DeviceName{"Home Buttons a1b2c3"});
+  for (uint8_t i = 0; i < NUM_BUTTONS; i++) {
+    state.set_btn_label(i + 1, LABELS[i % (sizeof(LABELS) / sizeof(*LABELS))]);
+  }
+  state.set_ip(IPAddress(192, 168, 1, 42));
+  state.persisted().setup_done = true;
+  state.persisted().wifi_done = true;
+  state.sensors().temperature = 22.5;
+  state.sensors().humidity = 45.0;
+  state.sensors().battery_present = true;
+  state.sensors().battery_pct = 87;
+  state.sensors().battery_voltage = 4.05;
+}
+
+static uint32_t render(Display& display, const Page& page) {
+  page.show(display);
+  delay(DISPLAY_CMD_SETTLE_TIME);
+  uint32_t start = micros();
+  display.update();
+  return micros() - start;
+}
+
+static uint32_t update_info(Display& display, DeviceState& state,
+                            float temp_change) {
+  state.sensors().temperature += temp_change;
+  delay(AWAKE_REDRAW_INTERVAL);
+  uint32_t start = micros();
+  display.update();
+  return micros() - start;
+}
+
+static bool write_pbm(const std::string& path) {
+  const HostPanel& panel = host_panel();
+  FILE* fp = fopen(path.c_str(), "wb");
+  if (fp == nullptr) {
+    fprintf(stderr, "failed to open '%s'\n", path.c_str());
+    return false;
+  }
+  // PBM: 1 = black, the panel buffer: 1 = white
+  fprintf(fp, "P4\n%u %u\n", panel.width, panel.height);
+  for (uint8_t byte : panel.screen) {
+    fputc(static_cast<uint8_t>(~byte), fp);
+  }
+  fclose(fp);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr,
+            "usage: %s <out_dir> [--fs <dir>] [--repeat <n>] [--verbose]\n",
+            argv[0]);
+    return 2;
+  }
+  std::string out_dir = argv[1];
+  std::string fs_root = ".";
+  int repeat = 10;
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "--fs") == 0 && i + 1 < argc) {
+      fs_root = argv[++i];
+    } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+      repeat = std::max(1, atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--verbose") == 0) {
+      host_log_level = ESP_LOG_DEBUG;
+    }
+  }
+  SPIFFS.set_root(fs_root);
+
+  HardwareDefinition hw;
+  DeviceState state;
+  setup_state(hw, state);
+  MDIHelper mdi;
+  Display display(state, mdi);
+  display.begin(hw);
+
+  size_t buffers = EPDDriver::WIDTH / 8 * PANEL_BUFFER_HEIGHT(EPDDriver);
+#if !defined(HOME_BUTTONS_PAGED_RENDERING)
+  buffers += 2 * (EPDDriver::WIDTH / 8 * EPDDriver::HEIGHT);  // canvas, frame
+#endif
+  printf("buffers %zu\n", buffers);
+
+  for (const Page& page : PAGES) {
+    uint32_t refreshes = host_panel().refresh_count;
+    uint32_t cold_us = render(display, page);
+    uint32_t present_us = host_panel().present_us;
+    if (host_panel().refresh_count == refreshes) {
+      fprintf(stderr, "%s: nothing drawn\n", page.name);
+      return 1;
+    }
+    if (!write_pbm(out_dir + "/" + page.name + ".pbm")) {
+      return 1;
+    }
+    std::vector<uint8_t> cold_screen = host_panel().screen;
+    uint32_t warm_us = UINT32_MAX;
+    for (int i = 1; i < repeat; i++) {
+      warm_us = std::min(warm_us, render(display, page));
+      if (host_panel().screen != cold_screen) {
+        fprintf(stderr, "%s: repeat %d differs from the first render\n",
+                page.name, i);
+        write_pbm(out_dir + "/" + page.name + ".warm.pbm");
+        return 1;
+      }
+    }
+    if (repeat == 1) {
+      warm_us = cold_us;
+    }
+    printf("%s %u %u %u\n", page.name, cold_us, warm_us, present_us);
+  }
+
+  // live info page: a changed value is pushed with a partial refresh
+  display.disp_info();
+  delay(DISPLAY_CMD_SETTLE_TIME);
+  display.update();
+  uint32_t partials = host_panel().partial_refresh_count;
+  uint32_t cold_us = update_info(display, state, 1.0);
+  uint32_t present_us = host_panel().present_us;
+  if (host_panel().partial_refresh_count == partials) {
+    fprintf(stderr, "info_live: no partial refresh\n");
+    return 1;
+  }
+  if (!write_pbm(out_dir + "/info_live.pbm")) {
+    return 1;
+  }
+  uint32_t warm_us = cold_us;
+  for (int i = 1; i < repeat; i++) {
+    warm_us = std::min(warm_us, update_info(display, state, i % 2 ? -1 : 1));
+  }
+  printf("info_live %u %u %u\n", cold_us, warm_us, present_us);
+  return 0;
+}
@@ -0,0 +1,298 @@
+#!/usr/bin/env python
+
+# Builds the display module for the host, renders every page of each model
+# off-screen and compares the result against golden images.
+#
+# The Arduino / ESP-IDF / GxEPD2 parts are replaced by the stand-ins in
+# shim/. Adafruit GFX, U8g2_for_Adafruit_GFX, QRCode and semver are the
+# minimal stand-ins in stand_ins/ (text drawn as boxes), whose output is
+# committed in golden/stand_ins/<model>/. With --libdeps the real libraries
+# are taken from the PlatformIO library folder instead:
+#
+#   pio pkg install -e original_release -e mini_release -e pro_release
+#   tools/host_render/host_render.py --libdeps .pio/libdeps --update
+#
+# and compared against golden/libdeps/<model>/, which is recorded locally.
+#
+# The stand-in goldens only check layout: glyph shapes and QR contents are
+# not drawn. Record golden/libdeps before relying on the tool as a
+# regression gate for text or QR output. Times are host times of the
+# stand-ins, the panel transfer is a memory copy. They compare code paths
+# with each other, they are not device timings.
+#
+# Usage:
+#   tools/host_render/host_render.py                  # all models
+#   tools/host_render/host_render.py -m mini --fs icons
+#   tools/host_render/host_render.py --paged          # band buffer rendering
+#   tools/host_render/host_render.py --glyphs glyphs.bin  # glyph font
+#
+# Output (PBM + PNG per page) goes to .pio/host_render/<model>/. A page
+# without a golden image fails, --update writes them. Paged builds are
+# compared against the same golden images. Every page is rendered again
+# --repeat times (from the stored display list and frame cache) and must
+# look the same as the first time.
+# Icons are read from <fs>/mdi/<size>/<name>.bmp, missing icons are drawn as
+# the placeholder. Without --fs, a fresh folder with generated test icons is
+# used. --glyphs copies a glyph font (tools/pack_glyphs.py) to
+# <fs>/glyphs.bin, icons in it are drawn from their outlines.
+
+import argparse
+import os
+import shutil
+import struct
+import subprocess
+import sys
+import zlib
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+PROJECT_DIR = os.path.abspath(os.path.join(SCRIPT_DIR, "..", ".."))
+SRC_DIR = os.path.join(PROJECT_DIR, "src")
+SHIM_DIR = os.path.join(SCRIPT_DIR, "shim")
+STAND_IN_DIR = os.path.join(SCRIPT_DIR, "stand_ins")
+
+MODELS = ["original", "mini", "pro"]
+
+# generated into the default file system, the icons of the labels in
+# host_render.cpp and of the test page, at the sizes the pages draw
+TEST_ICONS = ["alien", "blinds", "fan", "garage", "lightbulb", "television"]
+TEST_ICON_SIZES = [48, 64, 92, 100]
+
+FIRMWARE_SOURCES = [
+    os.path.join(SRC_DIR, "display", "display.cpp"),
+    os.path.join(SRC_DIR, "display", "display_list.cpp"),
+    os.path.join(SRC_DIR, "state.cpp"),
+    os.path.join(SRC_DIR, "mdi", "mdi_helper.cpp"),
+    os.path.join(SRC_DIR, "mdi", "icon_cache.cpp"),
+    os.path.join(SRC_DIR, "mdi", "icon_manifest.cpp"),
+    os.path.join(SRC_DIR, "mdi", "icon_pack.cpp"),
+    os.path.join(SRC_DIR, "mdi", "icon_storage.cpp"),
+    os.path.join(SRC_DIR, "mdi", "icon_validators.cpp"),
+    os.path.join(SRC_DIR, "mdi", "glyph_font.cpp"),
+    os.path.join(SRC_DIR, "mdi", "rasterizer.cpp"),
+    os.path.join(SHIM_DIR, "host.cpp"),
+    os.path.join(SCRIPT_DIR, "host_render.cpp"),
+]
+
+# file name -> compile it (or only add its folder to the include path)
+LIBRARY_FILES = {
+    "Adafruit_GFX.cpp": True,
+    "U8g2_for_Adafruit_GFX.cpp": True,
+    "u8g2_fonts.c": True,
+    "qrcode.c": True,
+    "semver.hpp": False,
+}
+
+
+def find_library_files(libdeps):
+    found = {}
+    for root, dirs, files in os.walk(libdeps):
+        dirs.sort()
+        for name in files:
+            if name in LIBRARY_FILES and name not in found:
+                found[name] = os.path.join(root, name)
+    missing = [name for name in LIBRARY_FILES if name not in found]
+    if missing:
+        raise RuntimeError("{} not found in {} - run 'pio pkg install' "
+                           "first".format(", ".join(missing), libdeps))
+    return found
+
+
+def build(model, libdeps, build_dir, cc, cxx, paged=False):
+    libs = find_library_files(libdeps)
+    include_dirs = [SHIM_DIR, SRC_DIR] + sorted(
+        {os.path.dirname(path) for path in libs.values()})
+    flags = ["-O2", "-DARDUINO=10812",
+             "-DHOME_BUTTONS_" + model.upper(),
+             "-DLOGGER_DEFAULT_LOG_LEVEL=ESP_LOG_INFO"]
+    if paged:
+        flags.append("-DHOME_BUTTONS_PAGED_RENDERING")
+    flags += ["-I" + path for path in include_dirs]
+
+    sources = FIRMWARE_SOURCES + [
+        path for name, path in libs.items() if LIBRARY_FILES[name]]
+    obj_dir = os.path.join(build_dir, "obj")
+    os.makedirs(obj_dir, exist_ok=True)
+    objects = []
+    for source in sources:
+        obj = os.path.join(obj_dir, os.path.basename(source) + ".o")
+        if source.endswith(".c"):
+            cmd = [cc] + flags + ["-c", source, "-o", obj]
+        else:
+            cmd = [cxx, "-std=gnu++17"] + flags + ["-c", source, "-o", obj]
+        subprocess.run(cmd, check=True)
+        objects.append(obj)
+
+    binary = os.path.join(build_dir, "host_render")
+    subprocess.run([cxx] + objects + ["-o", binary, "-lz"], check=True)
+    return binary
+
+
+def write_test_icon(path, name, size):
+    # 1-bit BMP: a ring with a square in the middle, sized by the name
+    row_bytes = (size + 31) // 32 * 4
+    mark = size // 8 + zlib.crc32(name.encode()) % (size // 4)
+    center = (size - 1) / 2
+    rows = []
+    for y in range(size - 1, -1, -1):  # bottom-up
+        row = bytearray(row_bytes)
+        for x in range(size):
+            r = ((x - center) ** 2 + (y - center) ** 2) ** 0.5
+            black = (size * 3 // 8 <= r < size // 2 or
+                     (abs(x - center) < mark / 2 and
+                      abs(y - center) < mark / 2))
+            if black:
+                row[x // 8] |= 0x80 >> (x % 8)
+        rows.append(bytes(row))
+    pixels = b"".join(rows)
+    header = struct.pack("<2sIHHI", b"BM", 62 + len(pixels), 0, 0, 62)
+    info = struct.pack("<IiiHHIIiiII", 40, size, size, 1, 1, 0, len(pixels),
+                       2835, 2835, 2, 2)
+    palette = b"\xff\xff\xff\x00\x00\x00\x00\x00"  # 0 white, 1 black
+    os.makedirs(os.path.dirname(path), exist_ok=True)
+    with open(path, "wb") as f:
+        f.write(header + info + palette + pixels)
+
+
+def make_test_fs(fs_dir):
+    shutil.rmtree(fs_dir, ignore_errors=True)
+    for size in TEST_ICON_SIZES:
+        for name in TEST_ICONS:
+            write_test_icon(
+                os.path.join(fs_dir, "mdi", str(size), name + ".bmp"), name,
+                size)
+
+
+def read_pbm(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    magic, size, pixels = data.split(b"\n", 2)
+    if magic != b"P4":
+        raise ValueError("{}: not a binary PBM".format(path))
+    width, height = (int(v) for v in size.split())
+    return width, height, pixels
+
+
+def write_pbm(path, width, height, pixels):
+    with open(path, "wb") as f:
+        f.write("P4\n{} {}\n".format(width, height).encode())
+        f.write(pixels)
+
+
+def write_png(path, width, height, pixels):
+    # 1-bit grayscale, PNG uses 1 = white, PBM 1 = black
+    row_bytes = (width + 7) // 8
+    raw = b"".join(
+        b"\x00" + bytes(~b & 0xFF for b in pixels[y * row_bytes:
+                                                  (y + 1) * row_bytes])
+        for y in range(height))
+
+    def chunk(kind, body):
+        crc = zlib.crc32(kind + body) & 0xFFFFFFFF
+        return struct.pack(">I", len(body)) + kind + body + struct.pack(
+            ">I", crc)
+
+    with open(path, "wb") as f:
+        f.write(b"\x89PNG\r\n\x1a\n")
+        f.write(chunk(b"IHDR", struct.pack(">IIBBBBB", width, height, 1, 0,
+                                           0, 0, 0)))
+        f.write(chunk(b"IDAT", zlib.compress(raw, 9)))
+        f.write(chunk(b"IEND", b""))
+
+
+def compare(page, out_dir, golden_dir, update):
+    width, height, pixels = read_pbm(os.path.join(out_dir, page + ".pbm"))
+    write_png(os.path.join(out_dir, page + ".png"), width, height, pixels)
+    golden_path = os.path.join(golden_dir, page + ".pbm")
+    if update:
+        os.makedirs(golden_dir, exist_ok=True)
+        write_pbm(golden_path, width, height, pixels)
+        return "updated"
+    if not os.path.isfile(golden_path):
+        return "FAIL no golden, record with --update"
+    g_width, g_height, g_pixels = read_pbm(golden_path)
+    if (g_width, g_height) != (width, height):
+        return "FAIL size {}x{}, golden {}x{}".format(width, height, g_width,
+                                                      g_height)
+    diff = bytes(a ^ b for a, b in zip(pixels, g_pixels))
+    count = sum(bin(b).count("1") for b in diff)
+    if count == 0:
+        return "ok"
+    diff_path = os.path.join(out_dir, page + ".diff")
+    write_pbm(diff_path + ".pbm", width, height, diff)
+    write_png(diff_path + ".png", width, height, diff)
+    return "FAIL {} pixels differ".format(count)
+
+
+def run_model(model, args):
+    name = model + "_paged" if args.paged else model
+    build_dir = os.path.join(args.out, name)
+    if args.libdeps:
+        libdeps = os.path.join(args.libdeps, model + "_release")
+    else:
+        libdeps = STAND_IN_DIR
+    print("### {} ###".format(name), flush=True)
+    binary = build(model, libdeps, build_dir, args.cc, args.cxx, args.paged)
+
+    if args.fs:
+        fs_dir = os.path.abspath(args.fs)
+    else:
+        fs_dir = os.path.join(build_dir, "fs")
+        make_test_fs(fs_dir)
+    if args.glyphs:
+        shutil.copyfile(args.glyphs, os.path.join(fs_dir, "glyphs.bin"))
+    cmd = [binary, build_dir, "--repeat", str(args.repeat), "--fs", fs_dir]
+    if args.verbose:
+        cmd.append("--verbose")
+    result = subprocess.run(cmd, check=True, stdout=subprocess.PIPE,
+                            universal_newlines=True)
+
+    ok = True
+    golden = args.golden or os.path.join(
+        SCRIPT_DIR, "golden", "libdeps" if args.libdeps else "stand_ins")
+    golden_dir = os.path.join(golden, model)
+    print("{:<14} {:>10} {:>10} {:>10}  {}".format(
+        "page", "cold [us]", "warm [us]", "prsnt [us]", "golden"))
+    for line in result.stdout.splitlines():
+        if line.startswith("buffers "):
+            buffers = int(line.split()[1])
+            continue
+        page, cold_us, warm_us, present_us = line.split()
+        status = compare(page, build_dir, golden_dir, args.update)
+        ok = ok and not status.startswith("FAIL")
+        print("{:<14} {:>10} {:>10} {:>10}  {}".format(
+            page, cold_us, warm_us, present_us, status))
+    print("frame buffers: {} bytes".format(buffers))
+    return ok
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Off-screen page renderer")
+    parser.add_argument("-m", "--model", choices=MODELS + ["all"],
+                        default="all")
+    parser.add_argument("--libdeps", help="PlatformIO library folder, "
+                        "e.g. .pio/libdeps (default: stand_ins/)")
+    parser.add_argument("--out",
+                        default=os.path.join(PROJECT_DIR, ".pio",
+                                             "host_render"))
+    parser.add_argument("--golden", help="golden image folder (default: "
+                        "golden/stand_ins or golden/libdeps)")
+    parser.add_argument("--fs", help="folder mapped to the icon storage "
+                        "(default: fresh, with test icons)")
+    parser.add_argument("--glyphs", help="glyph font, copied to the icon "
+                        "storage")
+    parser.add_argument("--repeat", type=int, default=10)
+    parser.add_argument("--paged", action="store_true",
+                        help="build with HOME_BUTTONS_PAGED_RENDERING")
+    parser.add_argument("--update", action="store_true",
+                        help="overwrite the golden images")
+    parser.add_argument("--cc", default=os.environ.get("CC", "cc"))
+    parser.add_argument("--cxx", default=os.environ.get("CXX", "c++"))
+    parser.add_argument("-v", "--verbose", action="store_true")
+    args = parser.parse_args()
+
+    models = MODELS if args.model == "all" else [args.model]
+    if not args.libdeps:
+        print("stand-in libraries: text drawn as boxes, fixed QR pattern, "
+              "host timings of the stand-ins")
+    results = [run_model(model, args) for model in models]
+    sys.exit(0 if all(results) else 1)
@@ -0,0 +1 @@
+// Adafruit_GFX.h includes the BusIO headers, nothing of them is used.
@@ -0,0 +1,60 @@
+// Host stand-in for the parts of the Arduino core used by the display module.
+// Time is virtual: delay() advances the clock without sleeping, so settle
+// times and timeouts don't slow down rendering.
+
+#ifndef HOST_RENDER_ARDUINO_H
+#define HOST_RENDER_ARDUINO_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "Print.h"
+#include "WString.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "pgmspace.h"
+
+using std::max;
+using std::min;
+
+#define IRAM_ATTR
+#define RTC_DATA_ATTR
+
+#define LOW 0x0
+#define HIGH 0x1
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+void attachInterruptArg(uint8_t pin, void (*isr)(void*), void* arg, int mode);
+void detachInterrupt(uint8_t pin);
+
+typedef enum {
+  ESP_SLEEP_WAKEUP_UNDEFINED,
+  ESP_SLEEP_WAKEUP_EXT1,
+  ESP_SLEEP_WAKEUP_TIMER
+} esp_sleep_wakeup_cause_t;
+// the renderer always starts cold
+inline esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause() {
+  return ESP_SLEEP_WAKEUP_UNDEFINED;
+}
+
+#endif  // HOST_RENDER_ARDUINO_H
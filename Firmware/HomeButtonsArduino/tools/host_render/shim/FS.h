@@ -0,0 +1,75 @@
+// Host file system backed by a local directory, see SPIFFS.h.
+
+#ifndef HOST_RENDER_FS_H
+#define HOST_RENDER_FS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+class File {
+ public:
+  struct Impl;
+
+  File() = default;
+  explicit File(std::shared_ptr<Impl> impl) : impl_(std::move(impl)) {}
+
+  size_t write(uint8_t c);
+  size_t write(const uint8_t* buf, size_t size);
+  int read();
+  size_t read(uint8_t* buf, size_t size);
+  size_t readBytes(char* buf, size_t size) {
+    return read(reinterpret_cast<uint8_t*>(buf), size);
+  }
+  int available();
+  bool seek(uint32_t pos, SeekMode mode = SeekSet);
+  size_t position() const;
+  size_t size() const;
+  void flush();
+  void close();
+  operator bool() const;
+
+  const char* path() const;
+  const char* name() const;
+  bool isDirectory() const;
+  File openNextFile(const char* mode = FILE_READ);
+
+ private:
+  std::shared_ptr<Impl> impl_;
+};
+
+class FS {
+ public:
+  explicit FS(std::string root = ".") : root_(std::move(root)) {}
+
+  void set_root(const std::string& root) { root_ = root; }
+
+  File open(const char* path, const char* mode = FILE_READ,
+            bool create = false);
+  bool exists(const char* path);
+  bool remove(const char* path);
+  bool rename(const char* from, const char* to);
+  bool mkdir(const char* path);
+
+ protected:
+  std::string root_;
+};
+
+}  // namespace fs
+
+using fs::File;
+using fs::FS;
+using fs::SeekCur;
+using fs::SeekEnd;
+using fs::SeekSet;
+
+#endif  // HOST_RENDER_FS_H
@@ -0,0 +1,348 @@
+// In-memory stand-in for GxEPD2_BW and the panel drivers used by the
+// firmware. Controller RAM and the refreshed (visible) image are kept in
+// host_panel() so host_render can read back what the panel would show.
+
+#ifndef HOST_RENDER_GXEPD2_BW_H
+#define HOST_RENDER_GXEPD2_BW_H
+
+#include <Adafruit_GFX.h>
+#include <Arduino.h>
+#include <SPI.h>
+
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "GxEPD2.h"
+
+struct HostPanel {
+  uint16_t width = 0;
+  uint16_t height = 0;
+  std::vector<uint8_t> ram;     // written by writeImage*()
+  std::vector<uint8_t> screen;  // copy of ram at the last refresh
+  uint32_t refresh_count = 0;
+  uint32_t partial_refresh_count = 0;
+  // time from the first write of a frame to the last one after its refresh,
+  // i.e. the cost of Display::present() without the panel refresh
+  uint32_t present_start = 0;
+  uint32_t present_us = 0;
+};
+
+HostPanel& host_panel();
+
+template <uint16_t W, uint16_t H>
+class HostEPD {
+ public:
+  static const uint16_t WIDTH = W;
+  static const uint16_t WIDTH_VISIBLE = W;
+  static const uint16_t HEIGHT = H;
+  static const bool hasColor = false;
+  static const bool hasPartialUpdate = true;
+  static const bool hasFastPartialUpdate = true;
+
+  HostEPD(int16_t cs, int16_t dc, int16_t rst, int16_t busy) {}
+
+  void init(uint32_t serial_diag_bitrate = 0, bool initial = true,
+            uint16_t reset_duration = 10, bool pulldown_rst_mode = false) {
+    HostPanel& panel = host_panel();
+    if (panel.width != W || panel.height != H) {
+      panel.width = W;
+      panel.height = H;
+      panel.ram.assign(W / 8 * H, 0xFF);
+      panel.screen.assign(W / 8 * H, 0xFF);
+    }
+  }
+  void selectSPI(SPIClass& spi, SPISettings spi_settings) {}
+  void setBusyCallback(void (*busy_callback)(const void*),
+                       const void* busy_callback_parameter = 0) {
+    busy_callback_ = busy_callback;
+    busy_callback_parameter_ = busy_callback_parameter;
+  }
+
+  void writeImage(const uint8_t bitmap[], int16_t x, int16_t y, int16_t w,
+                  int16_t h, bool invert = false, bool mirror_y = false,
+                  bool pgm = false) {
+    _transfer_start();
+    _write(bitmap, x, y, w, h, invert, mirror_y);
+  }
+  void writeImageForFullRefresh(const uint8_t bitmap[], int16_t x, int16_t y,
+                                int16_t w, int16_t h, bool invert = false,
+                                bool mirror_y = false, bool pgm = false) {
+    _transfer_start();
+    _write(bitmap, x, y, w, h, invert, mirror_y);
+  }
+  void writeImageAgain(const uint8_t bitmap[], int16_t x, int16_t y,
+                       int16_t w, int16_t h, bool invert = false,
+                       bool mirror_y = false, bool pgm = false) {
+    _write(bitmap, x, y, w, h, invert, mirror_y);
+    _transfer_end();
+  }
+
+  // copies the area x_part, y_part, w, h of the bitmap to x, y, x is
+  // rounded down to a multiple of 8 and w up, as in GxEPD2
+  void writeImagePart(const uint8_t bitmap[], int16_t x_part, int16_t y_part,
+                      int16_t w_bitmap, int16_t h_bitmap, int16_t x,
+                      int16_t y, int16_t w, int16_t h, bool invert = false,
+                      bool mirror_y = false, bool pgm = false) {
+    _transfer_start();
+    _part(bitmap, x_part, y_part, w_bitmap, h_bitmap, x, y, w, h, invert);
+  }
+  void writeImagePartAgain(const uint8_t bitmap[], int16_t x_part,
+                           int16_t y_part, int16_t w_bitmap,
+                           int16_t h_bitmap, int16_t x, int16_t y, int16_t w,
+                           int16_t h, bool invert = false,
+                           bool mirror_y = false, bool pgm = false) {
+    _part(bitmap, x_part, y_part, w_bitmap, h_bitmap, x, y, w, h, invert);
+    _transfer_end();
+  }
+
+  // the busy callback runs once, as if the refresh took a single BUSY wait
+  void refresh(bool partial_update_mode = false) {
+    if (busy_callback_ != nullptr) {
+      busy_callback_(busy_callback_parameter_);
+    }
+    HostPanel& panel = host_panel();
+    panel.screen = panel.ram;
+    panel.refresh_count++;
+    transferring_ = false;
+  }
+  void refresh(int16_t x, int16_t y, int16_t w, int16_t h) {
+    host_panel().partial_refresh_count++;
+    refresh(true);
+  }
+  void powerOff() {}
+  void hibernate() {}
+
+ private:
+  void (*busy_callback_)(const void*) = nullptr;
+  const void* busy_callback_parameter_ = nullptr;
+  bool transferring_ = false;
+
+  // first write of a frame
+  void _transfer_start() {
+    if (transferring_) return;
+    transferring_ = true;
+    host_panel().present_start = micros();
+  }
+  // a write after the refresh, the last one ends the frame
+  void _transfer_end() {
+    HostPanel& panel = host_panel();
+    panel.present_us = micros() - panel.present_start;
+  }
+
+  void _part(const uint8_t bitmap[], int16_t x_part, int16_t y_part,
+             int16_t w_bitmap, int16_t h_bitmap, int16_t x, int16_t y,
+             int16_t w, int16_t h, bool invert) {
+    HostPanel& panel = host_panel();
+    int16_t right = x + w;
+    x -= x % 8;
+    x_part -= x_part % 8;
+    uint16_t row_bytes = (right - x + 7) / 8;
+    for (int16_t j = 0; j < h; j++) {
+      int16_t row = y + j;
+      int16_t src_row = y_part + j;
+      if (row < 0 || row >= H || src_row < 0 || src_row >= h_bitmap) continue;
+      const uint8_t* src = bitmap + src_row * ((w_bitmap + 7) / 8);
+      for (uint16_t i = 0; i < row_bytes; i++) {
+        int16_t col = x / 8 + i;
+        int16_t src_col = x_part / 8 + i;
+        if (col < 0 || col >= W / 8 || src_col >= (w_bitmap + 7) / 8) continue;
+        panel.ram[row * (W / 8) + col] = invert ? ~src[src_col] : src[src_col];
+      }
+    }
+  }
+
+  // x and w are multiples of 8, as in GxEPD2
+  void _write(const uint8_t bitmap[], int16_t x, int16_t y, int16_t w,
+              int16_t h, bool invert, bool mirror_y) {
+    HostPanel& panel = host_panel();
+    uint16_t row_bytes = w / 8;
+    for (int16_t j = 0; j < h; j++) {
+      int16_t row = y + j;
+      if (row < 0 || row >= H) continue;
+      const uint8_t* src = bitmap + (mirror_y ? h - 1 - j : j) * row_bytes;
+      for (uint16_t i = 0; i < row_bytes; i++) {
+        int16_t col = x / 8 + i;
+        if (col < 0 || col >= W / 8) continue;
+        panel.ram[row * (W / 8) + col] = invert ? ~src[i] : src[i];
+      }
+    }
+  }
+};
+
+using GxEPD2_290_T94_V2 = HostEPD<128, 296>;
+using GxEPD2_154_D67 = HostEPD<200, 200>;
+using GxEPD2_420_GDEY042T91 = HostEPD<400, 300>;
+
+template <typename GxEPD2_Type, const uint16_t page_height>
+class GxEPD2_BW : public Adafruit_GFX {
+ public:
+  GxEPD2_Type epd2;
+
+  GxEPD2_BW(GxEPD2_Type epd2_instance)
+      : Adafruit_GFX(GxEPD2_Type::WIDTH_VISIBLE, GxEPD2_Type::HEIGHT),
+        epd2(epd2_instance) {
+    memset(buffer_, 0xFF, sizeof(buffer_));
+  }
+
+  void init(uint32_t serial_diag_bitrate = 0) {
+    epd2.init(serial_diag_bitrate);
+  }
+  void init(uint32_t serial_diag_bitrate, bool initial,
+            uint16_t reset_duration = 10, bool pulldown_rst_mode = false) {
+    epd2.init(serial_diag_bitrate, initial, reset_duration, pulldown_rst_mode);
+  }
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override {
+    if (x < 0 || x >= width() || y < 0 || y >= height()) return;
+    if (partial_ && (x < pw_x_ || x >= pw_x_ + pw_w_ || y < pw_y_ ||
+                     y >= pw_y_ + pw_h_)) {
+      return;
+    }
+    switch (getRotation()) {
+      case 1:
+        std::swap(x, y);
+        x = WIDTH - x - 1;
+        break;
+      case 2:
+        x = WIDTH - x - 1;
+        y = HEIGHT - y - 1;
+        break;
+      case 3:
+        std::swap(x, y);
+        y = HEIGHT - y - 1;
+        break;
+    }
+    // buffer rows are window wide in partial mode, as in GxEPD2
+    uint16_t row_bytes = WIDTH / 8;
+    if (partial_) {
+      x -= pw_x_;
+      y -= pw_y_;
+      row_bytes = pw_w_ / 8;
+    }
+    y -= page_y_;
+    if (y < 0 || y >= page_rows()) return;
+    uint8_t& byte = buffer_[x / 8 + y * row_bytes];
+    if (color == GxEPD_WHITE) {
+      byte |= 1 << (7 - x % 8);
+    } else {
+      byte &= ~(1 << (7 - x % 8));
+    }
+  }
+  void fillScreen(uint16_t color) override {
+    memset(buffer_, color == GxEPD_WHITE ? 0xFF : 0x00, sizeof(buffer_));
+  }
+
+  void setFullWindow() {
+    partial_ = false;
+    page_y_ = 0;
+  }
+  // the buffer stays full screen, drawing is clipped to the window
+  void setPartialWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
+    partial_ = true;
+    pw_x_ = x / 8 * 8;
+    pw_w_ = (x + w + 7) / 8 * 8 - pw_x_;
+    pw_y_ = y;
+    pw_h_ = h;
+    page_y_ = 0;
+  }
+
+  // same sequence as GxEPD2_BW::firstPage() / nextPage(), page_y_ is
+  // relative to the partial window
+  void firstPage() {
+    fillScreen(GxEPD_WHITE);
+    page_y_ = 0;
+    second_phase_ = false;
+  }
+  bool nextPage() {
+    uint16_t rows = partial_ ? pw_h_ : GxEPD2_Type::HEIGHT;
+    uint16_t h = std::min<uint16_t>(page_rows(), rows - page_y_);
+    int16_t x = partial_ ? pw_x_ : 0;
+    int16_t y = (partial_ ? pw_y_ : 0) + page_y_;
+    int16_t w = partial_ ? pw_w_ : GxEPD2_Type::WIDTH;
+    if (second_phase_) {
+      epd2.writeImageAgain(buffer_, x, y, w, h);
+    } else if (partial_) {
+      epd2.writeImage(buffer_, x, y, w, h);
+    } else {
+      epd2.writeImageForFullRefresh(buffer_, x, y, w, h);
+    }
+    page_y_ += page_rows();
+    if (page_y_ < rows) {
+      fillScreen(GxEPD_WHITE);
+      return true;
+    }
+    page_y_ = 0;
+    if (!second_phase_) {
+      if (partial_) {
+        epd2.refresh(pw_x_, pw_y_, pw_w_, pw_h_);
+      } else {
+        epd2.refresh(false);
+      }
+      if (GxEPD2_Type::hasFastPartialUpdate) {
+        second_phase_ = true;
+        fillScreen(GxEPD_WHITE);
+        return true;
+      }
+    }
+    if (!partial_) {
+      epd2.powerOff();
+    }
+    return false;
+  }
+
+  // same sequence as GxEPD2_BW::display(), which writes the whole buffer
+  // and ignores a partial window (its rows are window wide then)
+  void display(bool partial_update_mode = false) {
+    if (partial_update_mode) {
+      epd2.writeImage(buffer_, 0, 0, GxEPD2_Type::WIDTH, page_height);
+    } else {
+      epd2.writeImageForFullRefresh(buffer_, 0, 0, GxEPD2_Type::WIDTH,
+                                    page_height);
+    }
+    epd2.refresh(partial_update_mode);
+    if (GxEPD2_Type::hasFastPartialUpdate) {
+      epd2.writeImageAgain(buffer_, 0, 0, GxEPD2_Type::WIDTH, page_height);
+    }
+    if (!partial_update_mode) {
+      epd2.powerOff();
+    }
+  }
+
+  // same sequence as GxEPD2_BW::displayWindow(), the window is taken from
+  // the full window buffer
+  void displayWindow(int16_t x, int16_t y, int16_t w, int16_t h) {
+    x = std::min<int16_t>(x, width());
+    y = std::min<int16_t>(y, height());
+    w = std::min<int16_t>(w, width() - x);
+    h = std::min<int16_t>(h, height() - y);
+    epd2.writeImagePart(buffer_, x, y, GxEPD2_Type::WIDTH, page_height, x, y,
+                        w, h);
+    epd2.refresh(x, y, w, h);
+    if (GxEPD2_Type::hasFastPartialUpdate) {
+      epd2.writeImagePartAgain(buffer_, x, y, GxEPD2_Type::WIDTH, page_height,
+                               x, y, w, h);
+    }
+  }
+
+  void hibernate() { epd2.hibernate(); }
+  void powerOff() { epd2.powerOff(); }
+  uint8_t* getBuffer() { return buffer_; }
+
+ private:
+  uint8_t buffer_[(GxEPD2_Type::WIDTH / 8) * page_height];
+  bool partial_ = false;
+  bool second_phase_ = false;
+  int16_t page_y_ = 0;  // first row of the current page
+  uint16_t pw_x_ = 0;
+  uint16_t pw_y_ = 0;
+  uint16_t pw_w_ = 0;
+  uint16_t pw_h_ = 0;
+
+  // a narrower partial window fits more rows into the buffer
+  uint16_t page_rows() const {
+    return partial_ ? sizeof(buffer_) / (pw_w_ / 8) : page_height;
+  }
+};
+
+#endif  // HOST_RENDER_GXEPD2_BW_H
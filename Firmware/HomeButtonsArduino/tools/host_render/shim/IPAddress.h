@@ -0,0 +1,34 @@
+#ifndef HOST_RENDER_IPADDRESS_H
+#define HOST_RENDER_IPADDRESS_H
+
+#include <cstdint>
+#include <cstdio>
+
+#include "WString.h"
+
+class IPAddress {
+ public:
+  IPAddress() = default;
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : bytes_{a, b, c, d} {}
+
+  uint8_t operator[](int i) const { return bytes_[i]; }
+  uint8_t& operator[](int i) { return bytes_[i]; }
+
+  bool fromString(const char* str) {
+    unsigned int a, b, c, d;
+    if (sscanf(str, "%u.%u.%u.%u", &a, &b, &c, &d) != 4) return false;
+    *this = IPAddress(a, b, c, d);
+    return true;
+  }
+  String toString() const {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%u.%u.%u.%u", bytes_[0], bytes_[1], bytes_[2],
+             bytes_[3]);
+    return String(buf);
+  }
+
+ private:
+  uint8_t bytes_[4] = {0, 0, 0, 0};
+};
+
+#endif  // HOST_RENDER_IPADDRESS_H
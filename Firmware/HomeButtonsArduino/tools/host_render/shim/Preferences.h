@@ -0,0 +1,37 @@
+// Nothing is persisted on the host, all reads return the defaults. The state
+// shown on the rendered pages is set through DeviceState by host_render.
+
+#ifndef HOST_RENDER_PREFERENCES_H
+#define HOST_RENDER_PREFERENCES_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "WString.h"
+
+class Preferences {
+ public:
+  bool begin(const char* name, bool read_only = false) { return true; }
+  void end() {}
+  bool clear() { return true; }
+  bool remove(const char* key) { return true; }
+  size_t freeEntries() { return 0; }
+
+  size_t putString(const char* key, const char* value) { return 0; }
+  size_t putString(const char* key, const String& value) { return 0; }
+  size_t putUInt(const char* key, uint32_t value) { return 0; }
+  size_t putBool(const char* key, bool value) { return 0; }
+
+  size_t getString(const char* key, char* value, size_t max_len) { return 0; }
+  String getString(const char* key, const String& default_value = String()) {
+    return default_value;
+  }
+  uint32_t getUInt(const char* key, uint32_t default_value = 0) {
+    return default_value;
+  }
+  bool getBool(const char* key, bool default_value = false) {
+    return default_value;
+  }
+};
+
+#endif  // HOST_RENDER_PREFERENCES_H
@@ -0,0 +1,28 @@
+#ifndef HOST_RENDER_PRINT_H
+#define HOST_RENDER_PRINT_H
+
+#include <cstddef>
+#include <cstdint>
+
+class String;
+
+class Print {
+ public:
+  virtual ~Print() = default;
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size);
+  size_t write(const char* str);
+
+  size_t print(const char* str);
+  size_t print(const String& str);
+  size_t print(char c);
+  size_t print(int n);
+  size_t print(unsigned int n);
+  size_t print(long n);
+  size_t print(unsigned long n);
+  size_t print(double n, int digits = 2);
+
+  size_t println(const char* str = "");
+};
+
+#endif  // HOST_RENDER_PRINT_H
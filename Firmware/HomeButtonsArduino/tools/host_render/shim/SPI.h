@@ -0,0 +1,18 @@
+#ifndef HOST_RENDER_SPI_H
+#define HOST_RENDER_SPI_H
+
+#include <cstdint>
+
+#define SPI_MODE0 0x00
+
+class SPISettings {
+ public:
+  SPISettings(uint32_t clock = 1000000, uint8_t bit_order = 1,
+              uint8_t data_mode = SPI_MODE0) {}
+};
+
+class SPIClass {};
+
+extern SPIClass SPI;
+
+#endif  // HOST_RENDER_SPI_H
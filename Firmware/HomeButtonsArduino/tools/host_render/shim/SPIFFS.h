@@ -0,0 +1,29 @@
+// SPIFFS is mapped to a local directory, e.g. one holding mdi/<size>/*.bmp.
+
+#ifndef HOST_RENDER_SPIFFS_H
+#define HOST_RENDER_SPIFFS_H
+
+#include "FS.h"
+
+namespace fs {
+
+class SPIFFSFS : public FS {
+ public:
+  bool begin(bool format_on_fail = false, const char* base_path = "/spiffs",
+             uint8_t max_open_files = 10, const char* label = nullptr);
+  void end();
+  bool format();
+  size_t totalBytes();
+  size_t usedBytes();
+
+  bool mounted() const { return mounted_; }
+
+ private:
+  bool mounted_ = false;
+};
+
+}  // namespace fs
+
+extern fs::SPIFFSFS SPIFFS;
+
+#endif  // HOST_RENDER_SPIFFS_H
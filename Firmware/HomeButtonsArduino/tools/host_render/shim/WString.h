@@ -0,0 +1,29 @@
+#ifndef HOST_RENDER_WSTRING_H
+#define HOST_RENDER_WSTRING_H
+
+#include <string>
+
+class String {
+ public:
+  String(const char* str = "") : str_(str != nullptr ? str : "") {}
+  String(const std::string& str) : str_(str) {}
+
+  const char* c_str() const { return str_.c_str(); }
+  unsigned int length() const { return str_.length(); }
+  bool isEmpty() const { return str_.empty(); }
+
+  bool operator==(const String& other) const { return str_ == other.str_; }
+  bool operator==(const char* other) const { return str_ == other; }
+  bool operator!=(const String& other) const { return str_ != other.str_; }
+  bool operator!=(const char* other) const { return str_ != other; }
+  String& operator+=(const String& other) {
+    str_ += other.str_;
+    return *this;
+  }
+  String operator+(const String& other) const { return str_ + other.str_; }
+
+ private:
+  std::string str_;
+};
+
+#endif  // HOST_RENDER_WSTRING_H
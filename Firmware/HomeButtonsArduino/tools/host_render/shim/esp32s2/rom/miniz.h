@@ -0,0 +1,72 @@
+// The inflater of the ESP32-S2 ROM, backed by zlib on the host. Only raw
+// deflate streams are supported (no TINFL_FLAG_PARSE_ZLIB_HEADER).
+
+#ifndef HOST_RENDER_MINIZ_H
+#define HOST_RENDER_MINIZ_H
+
+#include <zlib.h>
+
+#include <cstddef>
+#include <cstdint>
+
+typedef enum {
+  TINFL_STATUS_BAD_PARAM = -3,
+  TINFL_STATUS_ADLER32_MISMATCH = -2,
+  TINFL_STATUS_FAILED = -1,
+  TINFL_STATUS_DONE = 0,
+  TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+  TINFL_STATUS_HAS_MORE_OUTPUT = 2,
+} tinfl_status;
+
+enum {
+  TINFL_FLAG_PARSE_ZLIB_HEADER = 1,
+  TINFL_FLAG_HAS_MORE_INPUT = 2,
+  TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF = 4,
+  TINFL_FLAG_COMPUTE_ADLER32 = 8,
+};
+
+typedef struct tinfl_decompressor_tag {
+  bool started;
+  z_stream stream;
+} tinfl_decompressor;
+
+#define tinfl_init(r) ((r)->started = false)
+
+// zlib keeps its own window, so the output goes straight to out_next
+inline tinfl_status tinfl_decompress(tinfl_decompressor* r,
+                                     const uint8_t* in_next, size_t* in_size,
+                                     uint8_t* out_start, uint8_t* out_next,
+                                     size_t* out_size, uint32_t flags) {
+  if (!r->started) {
+    r->stream = z_stream{};
+    if (inflateInit2(&r->stream, -15) != Z_OK) return TINFL_STATUS_FAILED;
+    r->started = true;
+  }
+  r->stream.next_in = const_cast<Bytef*>(in_next);
+  r->stream.avail_in = *in_size;
+  r->stream.next_out = out_next;
+  r->stream.avail_out = *out_size;
+  int ret = inflate(&r->stream, Z_NO_FLUSH);
+  *in_size -= r->stream.avail_in;
+  *out_size -= r->stream.avail_out;
+  if (ret == Z_STREAM_END) {
+    inflateEnd(&r->stream);
+    r->started = false;
+    return TINFL_STATUS_DONE;
+  }
+  if (ret != Z_OK && ret != Z_BUF_ERROR) {
+    inflateEnd(&r->stream);
+    r->started = false;
+    return TINFL_STATUS_FAILED;
+  }
+  if (r->stream.avail_out == 0) return TINFL_STATUS_HAS_MORE_OUTPUT;
+  if (!(flags & TINFL_FLAG_HAS_MORE_INPUT)) {
+    // the whole stream was given
+    inflateEnd(&r->stream);
+    r->started = false;
+    return TINFL_STATUS_FAILED;
+  }
+  return TINFL_STATUS_NEEDS_MORE_INPUT;
+}
+
+#endif  // HOST_RENDER_MINIZ_H
@@ -0,0 +1,34 @@
+#ifndef HOST_RENDER_ESP_LOG_H
+#define HOST_RENDER_ESP_LOG_H
+
+#include <cstdint>
+
+typedef enum {
+  ESP_LOG_NONE,
+  ESP_LOG_ERROR,
+  ESP_LOG_WARN,
+  ESP_LOG_INFO,
+  ESP_LOG_DEBUG,
+  ESP_LOG_VERBOSE
+} esp_log_level_t;
+
+#define LOG_COLOR_E "\033[0;31m"
+#define LOG_COLOR_W "\033[0;33m"
+#define LOG_COLOR_I "\033[0;32m"
+#define LOG_COLOR_D ""
+#define LOG_RESET_COLOR "\033[0m"
+
+// messages above this level are dropped, set by the host_render command line
+extern esp_log_level_t host_log_level;
+
+void esp_log_level_set(const char* tag, esp_log_level_t level);
+uint32_t esp_log_timestamp();
+void esp_log_write(esp_log_level_t level, const char* tag, const char* format,
+                   ...) __attribute__((format(printf, 3, 4)));
+
+#define ESP_LOGE(tag, format, ...) \
+  esp_log_write(ESP_LOG_ERROR, tag, "%s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) \
+  esp_log_write(ESP_LOG_DEBUG, tag, "%s: " format "\n", tag, ##__VA_ARGS__)
+
+#endif  // HOST_RENDER_ESP_LOG_H
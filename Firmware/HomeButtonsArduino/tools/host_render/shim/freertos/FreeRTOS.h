@@ -0,0 +1,27 @@
+// Single threaded host: critical sections and task notifications are no-ops.
+
+#ifndef HOST_RENDER_FREERTOS_H
+#define HOST_RENDER_FREERTOS_H
+
+#include <cstdint>
+
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+typedef void* TaskHandle_t;
+typedef void* SemaphoreHandle_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portMAX_DELAY 0xffffffffUL
+
+typedef struct {
+  int owner;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED \
+  { 0 }
+#define portENTER_CRITICAL(mux) (void)(mux)
+#define portEXIT_CRITICAL(mux) (void)(mux)
+#define portYIELD_FROM_ISR()
+
+#endif  // HOST_RENDER_FREERTOS_H
@@ -0,0 +1,18 @@
+#ifndef HOST_RENDER_SEMPHR_H
+#define HOST_RENDER_SEMPHR_H
+
+#include "FreeRTOS.h"
+
+inline SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() {
+  static int mutex;
+  return &mutex;
+}
+inline BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t mutex,
+                                          TickType_t ticks) {
+  return pdTRUE;
+}
+inline BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t mutex) {
+  return pdTRUE;
+}
+
+#endif  // HOST_RENDER_SEMPHR_H
@@ -0,0 +1,12 @@
+#ifndef HOST_RENDER_TASK_H
+#define HOST_RENDER_TASK_H
+
+#include "FreeRTOS.h"
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return nullptr; }
+inline uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) {
+  return 1;
+}
+inline void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* woken) {}
+
+#endif  // HOST_RENDER_TASK_H
@@ -0,0 +1,282 @@
+// Host implementations of the Arduino / ESP-IDF functions declared in shim/.
+
+#include <Arduino.h>
+#include <GxEPD2_BW.h>
+#include <Print.h>
+#include <SPI.h>
+#include <SPIFFS.h>
+#include <dirent.h>
+#include <esp_log.h>
+#include <sys/stat.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "mdi/download.h"
+
+// ------ time ------
+
+static uint64_t delay_offset_us = 0;
+
+static uint64_t now_us() {
+  static const auto start = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - start)
+             .count() +
+         delay_offset_us;
+}
+
+uint32_t millis() { return now_us() / 1000; }
+uint32_t micros() { return now_us(); }
+void delay(uint32_t ms) { delay_offset_us += ms * 1000ULL; }
+
+// ------ GPIO ------
+
+void pinMode(uint8_t pin, uint8_t mode) {}
+void digitalWrite(uint8_t pin, uint8_t val) {}
+int digitalRead(uint8_t pin) { return LOW; }  // BUSY never active
+void attachInterruptArg(uint8_t pin, void (*isr)(void*), void* arg,
+                        int mode) {}
+void detachInterrupt(uint8_t pin) {}
+
+SPIClass SPI;
+
+// ------ Print ------
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+  size_t n = 0;
+  while (size--) {
+    n += write(*buffer++);
+  }
+  return n;
+}
+
+size_t Print::write(const char* str) {
+  return write(reinterpret_cast<const uint8_t*>(str), strlen(str));
+}
+
+size_t Print::print(const char* str) { return write(str); }
+size_t Print::print(const String& str) { return write(str.c_str()); }
+size_t Print::print(char c) { return write(static_cast<uint8_t>(c)); }
+
+static size_t print_fmt(Print& p, const char* fmt, ...) {
+  char buf[32];
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(buf, sizeof(buf), fmt, args);
+  va_end(args);
+  return p.write(buf);
+}
+
+size_t Print::print(int n) { return print_fmt(*this, "%d", n); }
+size_t Print::print(unsigned int n) { return print_fmt(*this, "%u", n); }
+size_t Print::print(long n) { return print_fmt(*this, "%ld", n); }
+size_t Print::print(unsigned long n) { return print_fmt(*this, "%lu", n); }
+size_t Print::print(double n, int digits) {
+  return print_fmt(*this, "%.*f", digits, n);
+}
+size_t Print::println(const char* str) { return print(str) + write("\r\n"); }
+
+// ------ logging ------
+
+esp_log_level_t host_log_level = ESP_LOG_WARN;
+
+void esp_log_level_set(const char* tag, esp_log_level_t level) {}
+
+uint32_t esp_log_timestamp() { return millis(); }
+
+void esp_log_write(esp_log_level_t level, const char* tag, const char* format,
+                   ...) {
+  if (level > host_log_level) return;
+  va_list args;
+  va_start(args, format);
+  vfprintf(stderr, format, args);
+  va_end(args);
+}
+
+// ------ file system ------
+
+struct fs::File::Impl {
+  std::string path;
+  FILE* fp = nullptr;
+  DIR* dir = nullptr;
+  std::string dir_root;  // host path of the directory
+
+  ~Impl() {
+    if (fp != nullptr) fclose(fp);
+    if (dir != nullptr) closedir(dir);
+  }
+};
+
+size_t fs::File::write(uint8_t c) { return write(&c, 1); }
+
+size_t fs::File::write(const uint8_t* buf, size_t size) {
+  if (!impl_ || impl_->fp == nullptr) return 0;
+  return fwrite(buf, 1, size, impl_->fp);
+}
+
+int fs::File::read() {
+  if (!impl_ || impl_->fp == nullptr) return -1;
+  return fgetc(impl_->fp);
+}
+
+size_t fs::File::read(uint8_t* buf, size_t size) {
+  if (!impl_ || impl_->fp == nullptr) return 0;
+  return fread(buf, 1, size, impl_->fp);
+}
+
+int fs::File::available() {
+  if (!impl_ || impl_->fp == nullptr) return 0;
+  return size() - position();
+}
+
+bool fs::File::seek(uint32_t pos, SeekMode mode) {
+  if (!impl_ || impl_->fp == nullptr) return false;
+  int whence = mode == SeekSet   ? SEEK_SET
+               : mode == SeekCur ? SEEK_CUR
+                                 : SEEK_END;
+  return fseek(impl_->fp, pos, whence) == 0;
+}
+
+size_t fs::File::position() const {
+  if (!impl_ || impl_->fp == nullptr) return 0;
+  return ftell(impl_->fp);
+}
+
+size_t fs::File::size() const {
+  if (!impl_ || impl_->fp == nullptr) return 0;
+  long pos = ftell(impl_->fp);
+  fseek(impl_->fp, 0, SEEK_END);
+  long len = ftell(impl_->fp);
+  fseek(impl_->fp, pos, SEEK_SET);
+  return len;
+}
+
+void fs::File::flush() {
+  if (impl_ && impl_->fp != nullptr) fflush(impl_->fp);
+}
+
+void fs::File::close() { impl_.reset(); }
+
+fs::File::operator bool() const {
+  return impl_ && (impl_->fp != nullptr || impl_->dir != nullptr);
+}
+
+const char* fs::File::path() const { return impl_ ? impl_->path.c_str() : ""; }
+
+const char* fs::File::name() const {
+  if (!impl_) return "";
+  size_t slash = impl_->path.rfind('/');
+  return impl_->path.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+}
+
+bool fs::File::isDirectory() const { return impl_ && impl_->dir != nullptr; }
+
+fs::File fs::File::openNextFile(const char* mode) {
+  if (!impl_ || impl_->dir == nullptr) return File();
+  while (dirent* entry = readdir(impl_->dir)) {
+    if (entry->d_name[0] == '.') continue;
+    auto impl = std::make_shared<Impl>();
+    impl->path = impl_->path + "/" + entry->d_name;
+    impl->fp = fopen((impl_->dir_root + "/" + entry->d_name).c_str(), mode);
+    if (impl->fp != nullptr) return File(impl);
+  }
+  return File();
+}
+
+fs::File fs::FS::open(const char* path, const char* mode, bool create) {
+  std::string host_path = root_ + path;
+  auto impl = std::make_shared<File::Impl>();
+  impl->path = path;
+  struct stat st;
+  if (stat(host_path.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+    impl->dir = opendir(host_path.c_str());
+    impl->dir_root = host_path;
+  } else {
+    // SPIFFS has no directories, any path can be created
+    for (size_t pos = host_path.find('/', root_.size() + 1);
+         create && pos != std::string::npos;
+         pos = host_path.find('/', pos + 1)) {
+      ::mkdir(host_path.substr(0, pos).c_str(), 0755);
+    }
+    std::string fmode = std::string(mode) + "b";
+    impl->fp = fopen(host_path.c_str(), fmode.c_str());
+  }
+  return File(impl);
+}
+
+bool fs::FS::exists(const char* path) {
+  struct stat st;
+  return stat((root_ + path).c_str(), &st) == 0;
+}
+
+bool fs::FS::remove(const char* path) {
+  // keep the icon set intact, e.g. when the firmware fails to decode a BMP
+  esp_log_write(ESP_LOG_WARN, "FS", "not removing '%s' on the host\n", path);
+  return true;
+}
+
+bool fs::FS::rename(const char* from, const char* to) {
+  return ::rename((root_ + from).c_str(), (root_ + to).c_str()) == 0;
+}
+
+bool fs::FS::mkdir(const char* path) {
+  return ::mkdir((root_ + path).c_str(), 0755) == 0;
+}
+
+bool fs::SPIFFSFS::begin(bool format_on_fail, const char* base_path,
+                         uint8_t max_open_files, const char* label) {
+  mounted_ = true;
+  return true;
+}
+
+void fs::SPIFFSFS::end() { mounted_ = false; }
+
+bool fs::SPIFFSFS::format() { return false; }
+
+size_t fs::SPIFFSFS::totalBytes() { return 1 << 20; }
+
+size_t fs::SPIFFSFS::usedBytes() { return 0; }
+
+fs::SPIFFSFS SPIFFS;
+
+// ------ download ------
+
+// icons are never downloaded on the host, missing ones render as placeholder
+bool download::download_file_https(const char* host, const char* url,
+                                   File& file, const char* certificate) {
+  return false;
+}
+
+bool download::check_connection(const char* host, const char* url,
+                                const char* certificate) {
+  return false;
+}
+
+download::Client::Client(const char* certificate, size_t buffer_size,
+                         bool overlap_writes)
+    : certificate_(certificate),
+      buffer_size_(buffer_size),
+      overlap_writes_(overlap_writes),
+      http_(nullptr) {}
+
+download::Client::~Client() {}
+
+bool download::Client::get(const char* url, File& file, Request* request) {
+  requests_++;
+  status_ = -1;
+  file.close();
+  return false;
+}
+
+void download::Client::end() {}
+
+uint32_t download::Client::write_us() const { return 0; }
+
+// ------ panel ------
+
+HostPanel& host_panel() {
+  static HostPanel panel;
+  return panel;
+}
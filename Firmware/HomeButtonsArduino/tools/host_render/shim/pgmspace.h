@@ -0,0 +1,13 @@
+#ifndef HOST_RENDER_PGMSPACE_H
+#define HOST_RENDER_PGMSPACE_H
+
+#include <cstdint>
+
+#define PROGMEM
+#define PGM_P const char*
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t*)(addr))
+#define pgm_read_ptr(addr) (*(void* const*)(addr))
+
+#endif  // HOST_RENDER_PGMSPACE_H
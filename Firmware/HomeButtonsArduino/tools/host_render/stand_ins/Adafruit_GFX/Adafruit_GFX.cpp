@@ -0,0 +1 @@
+#include "Adafruit_GFX.h"
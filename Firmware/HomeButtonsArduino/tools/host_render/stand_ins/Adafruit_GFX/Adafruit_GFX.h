@@ -0,0 +1,116 @@
+// Stand-in for Adafruit GFX, see ../README.md.
+
+#ifndef HOST_RENDER_ADAFRUIT_GFX_H
+#define HOST_RENDER_ADAFRUIT_GFX_H
+
+#include <Adafruit_I2CDevice.h>
+#include <Adafruit_SPIDevice.h>
+#include <Arduino.h>
+#include <Print.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+class Adafruit_GFX : public Print {
+ public:
+  Adafruit_GFX(int16_t w, int16_t h)
+      : WIDTH(w), HEIGHT(h), _width(w), _height(h) {}
+
+  virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+  virtual void fillScreen(uint16_t color) {
+    fillRect(0, 0, _width, _height, color);
+  }
+  virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                        uint16_t color) {
+    for (int16_t j = y; j < y + h; j++) {
+      for (int16_t i = x; i < x + w; i++) {
+        drawPixel(i, j, color);
+      }
+    }
+  }
+  virtual void drawFastHLine(int16_t x, int16_t y, int16_t w,
+                             uint16_t color) {
+    fillRect(x, y, w, 1, color);
+  }
+  virtual void drawFastVLine(int16_t x, int16_t y, int16_t h,
+                             uint16_t color) {
+    fillRect(x, y, 1, h, color);
+  }
+  void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    drawFastHLine(x, y, w, color);
+    drawFastHLine(x, y + h - 1, w, color);
+    drawFastVLine(x, y, h, color);
+    drawFastVLine(x + w - 1, y, h, color);
+  }
+  void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                uint16_t color) {
+    int16_t n = std::max(abs(x1 - x0), abs(y1 - y0));
+    for (int16_t k = 0; k <= n; k++) {
+      drawPixel(x0 + (n ? (x1 - x0) * k / n : 0),
+                y0 + (n ? (y1 - y0) * k / n : 0), color);
+    }
+  }
+  void drawBitmap(int16_t x, int16_t y, const uint8_t bitmap[], int16_t w,
+                  int16_t h, uint16_t color) {
+    int16_t row_bytes = (w + 7) / 8;
+    for (int16_t j = 0; j < h; j++) {
+      for (int16_t i = 0; i < w; i++) {
+        if (bitmap[j * row_bytes + i / 8] & (0x80 >> (i & 7))) {
+          drawPixel(x + i, y + j, color);
+        }
+      }
+    }
+  }
+  void drawBitmap(int16_t x, int16_t y, const uint8_t bitmap[], int16_t w,
+                  int16_t h, uint16_t color, uint16_t bg) {
+    int16_t row_bytes = (w + 7) / 8;
+    for (int16_t j = 0; j < h; j++) {
+      for (int16_t i = 0; i < w; i++) {
+        bool set = bitmap[j * row_bytes + i / 8] & (0x80 >> (i & 7));
+        drawPixel(x + i, y + j, set ? color : bg);
+      }
+    }
+  }
+
+  void setRotation(uint8_t r) {
+    rotation = r & 3;
+    _width = (rotation & 1) ? HEIGHT : WIDTH;
+    _height = (rotation & 1) ? WIDTH : HEIGHT;
+  }
+  uint8_t getRotation() const { return rotation; }
+  int16_t width() const { return _width; }
+  int16_t height() const { return _height; }
+
+  size_t write(uint8_t) override { return 1; }
+
+ protected:
+  const int16_t WIDTH;
+  const int16_t HEIGHT;
+  int16_t _width;
+  int16_t _height;
+  uint8_t rotation = 0;
+};
+
+class GFXcanvas1 : public Adafruit_GFX {
+ public:
+  GFXcanvas1(uint16_t w, uint16_t h) : Adafruit_GFX(w, h) {
+    buffer = static_cast<uint8_t*>(calloc((w + 7) / 8 * h, 1));
+  }
+  ~GFXcanvas1() { free(buffer); }
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override {
+    if (x < 0 || y < 0 || x >= _width || y >= _height) return;
+    uint8_t* byte = &buffer[y * ((WIDTH + 7) / 8) + x / 8];
+    if (color) {
+      *byte |= 0x80 >> (x & 7);
+    } else {
+      *byte &= ~(0x80 >> (x & 7));
+    }
+  }
+  uint8_t* getBuffer() const { return buffer; }
+
+ private:
+  uint8_t* buffer;
+};
+
+#endif  // HOST_RENDER_ADAFRUIT_GFX_H
@@ -0,0 +1,22 @@
+#include "qrcode.h"
+
+uint16_t qrcode_getBufferSize(uint8_t version) { return 1; }
+
+int8_t qrcode_initText(QRCode* qrcode, uint8_t* modules, uint8_t version,
+                       uint8_t ecc, const char* data) {
+  uint8_t seed = 0;
+  for (const char* c = data; *c != '\0'; c++) {
+    seed = seed * 31 + (uint8_t)*c;
+  }
+  qrcode->version = version;
+  qrcode->size = 4 * version + 17;
+  qrcode->ecc = ecc;
+  qrcode->mode = 0;
+  qrcode->mask = seed;
+  qrcode->modules = modules;
+  return 0;
+}
+
+bool qrcode_getModule(QRCode* qrcode, uint8_t x, uint8_t y) {
+  return (x * y + qrcode->mask) % 3 == 0;
+}
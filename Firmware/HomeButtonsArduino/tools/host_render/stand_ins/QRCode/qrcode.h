@@ -0,0 +1,37 @@
+// Stand-in for QRCode (ricmoo), see ../README.md. Modules are a fixed
+// pattern, seeded by the text, in a code of the size of the version.
+
+#ifndef HOST_RENDER_QRCODE_H
+#define HOST_RENDER_QRCODE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct QRCode {
+  uint8_t version;
+  uint8_t size;
+  uint8_t ecc;
+  uint8_t mode;
+  uint8_t mask;
+  uint8_t* modules;
+} QRCode;
+
+#define ECC_LOW 0
+#define ECC_MEDIUM 1
+#define ECC_QUARTILE 2
+#define ECC_HIGH 3
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint16_t qrcode_getBufferSize(uint8_t version);
+int8_t qrcode_initText(QRCode* qrcode, uint8_t* modules, uint8_t version,
+                       uint8_t ecc, const char* data);
+bool qrcode_getModule(QRCode* qrcode, uint8_t x, uint8_t y);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // HOST_RENDER_QRCODE_H
@@ -0,0 +1 @@
+#include "U8g2_for_Adafruit_GFX.h"
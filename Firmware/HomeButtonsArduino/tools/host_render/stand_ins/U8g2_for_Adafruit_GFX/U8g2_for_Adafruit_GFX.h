@@ -0,0 +1,45 @@
+// Stand-in for U8g2_for_Adafruit_GFX, see ../README.md. Every character is
+// drawn as a filled box of the font's cell size.
+
+#ifndef HOST_RENDER_U8G2_FOR_ADAFRUIT_GFX_H
+#define HOST_RENDER_U8G2_FOR_ADAFRUIT_GFX_H
+
+#include <Adafruit_GFX.h>
+
+#include <cstring>
+
+#include "u8g2_fonts.h"
+
+class U8G2_FOR_ADAFRUIT_GFX : public Print {
+ public:
+  void begin(Adafruit_GFX& gfx) { gfx_ = &gfx; }
+  void setFontMode(uint8_t is_transparent) {}
+  void setForegroundColor(uint16_t color) { fg_ = color; }
+  void setBackgroundColor(uint16_t color) {}
+  void setFont(const uint8_t* font) { font_ = font; }
+  void setCursor(int16_t x, int16_t y) {
+    x_ = x;
+    y_ = y;
+  }
+
+  int16_t getUTF8Width(const char* str) { return strlen(str) * font_[0]; }
+  int8_t getFontAscent() { return font_[0] + 2; }
+  int8_t getFontDescent() { return -2; }
+
+  size_t write(uint8_t c) override {
+    if (c == '\n') return 1;
+    gfx_->fillRect(x_, y_ - font_[0], font_[0] - 1, font_[0], fg_);
+    x_ += font_[0];
+    return 1;
+  }
+  using Print::print;
+
+ private:
+  Adafruit_GFX* gfx_ = nullptr;
+  const uint8_t* font_ = u8g2_font_helvB12_tr;
+  int16_t x_ = 0;
+  int16_t y_ = 0;
+  uint16_t fg_ = 0;
+};
+
+#endif  // HOST_RENDER_U8G2_FOR_ADAFRUIT_GFX_H
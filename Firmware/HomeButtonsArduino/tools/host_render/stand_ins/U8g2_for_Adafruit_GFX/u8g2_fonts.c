@@ -0,0 +1,11 @@
+#include "u8g2_fonts.h"
+
+const uint8_t u8g2_font_courR12_tr[] = {8};
+const uint8_t u8g2_font_courR18_tf[] = {11};
+const uint8_t u8g2_font_helvB12_tr[] = {8};
+const uint8_t u8g2_font_helvB18_te[] = {12};
+const uint8_t u8g2_font_helvB18_tr[] = {12};
+const uint8_t u8g2_font_helvB24_te[] = {16};
+const uint8_t u8g2_font_helvB24_tr[] = {16};
+const uint8_t u8g2_font_profont12_tr[] = {6};
+const uint8_t u8g2_font_profont17_tr[] = {9};
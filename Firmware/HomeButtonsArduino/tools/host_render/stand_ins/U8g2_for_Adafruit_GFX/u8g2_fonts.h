@@ -0,0 +1,27 @@
+// Stand-in for the U8g2 fonts used by the firmware, see ../README.md.
+// A font is a single byte, the character cell size in pixels.
+
+#ifndef HOST_RENDER_U8G2_FONTS_H
+#define HOST_RENDER_U8G2_FONTS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern const uint8_t u8g2_font_courR12_tr[];
+extern const uint8_t u8g2_font_courR18_tf[];
+extern const uint8_t u8g2_font_helvB12_tr[];
+extern const uint8_t u8g2_font_helvB18_te[];
+extern const uint8_t u8g2_font_helvB18_tr[];
+extern const uint8_t u8g2_font_helvB24_te[];
+extern const uint8_t u8g2_font_helvB24_tr[];
+extern const uint8_t u8g2_font_profont12_tr[];
+extern const uint8_t u8g2_font_profont17_tr[];
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // HOST_RENDER_U8G2_FONTS_H
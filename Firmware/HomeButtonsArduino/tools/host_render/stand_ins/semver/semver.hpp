@@ -0,0 +1,22 @@
+// Stand-in for semver (Neargye), see ../README.md.
+
+#ifndef HOST_RENDER_SEMVER_HPP
+#define HOST_RENDER_SEMVER_HPP
+
+#include <cstdint>
+
+namespace semver {
+
+struct version {
+  uint8_t major = 0;
+  uint8_t minor = 0;
+  uint8_t patch = 0;
+
+  constexpr version() = default;
+  constexpr version(uint8_t mj, uint8_t mn, uint8_t pt)
+      : major(mj), minor(mn), patch(pt) {}
+};
+
+}  // namespace semver
+
+#endif  // HOST_RENDER_SEMVER_HPP
@@ -0,0 +1,222 @@
+#!/usr/bin/env python
+
+# Local stand-in for the icon repository (<size>x<size>/<name>.bmp), e.g. a
+# checkout of https://github.com/nplan/MDI-BMP. Speaks HTTP/1.1 with
+# keep-alive and counts TLS handshakes and requests per connection.
+#
+#   openssl req -x509 -newkey rsa:2048 -nodes -days 365 -subj /CN=localhost \
+#       -keyout key.pem -out cert.pem
+#   icon_server.py serve --root MDI-BMP --cert cert.pem --key key.pem
+#
+# Without --cert it serves plain HTTP, which is what the device expects from
+# a mirror on the local network ("Icon Server URL" in the setup, e.g.
+# http://192.168.1.10:8080/). "compress" stores a gzipped copy
+# (<name>.bmp.gz) next to every icon, the device fetches those first.
+#
+# "bench" downloads icons from a server with a new connection per request
+# (as download::download_file_https() does) and over one kept-alive
+# connection (download::Client) and compares the times, then compares plain
+# and gzipped icons over one connection.
+#
+# For the download benchmark on the device (firmware built with
+# -DHOME_BUTTONS_DOWNLOAD_BENCHMARK), "serve --cert" and set the "Icon Server
+# URL" to https://<this host>:8443/. The benchmark trusts any certificate of
+# a server other than the default one.
+
+import argparse
+import glob
+import gzip
+import http.client
+import http.server
+import os
+import socket
+import ssl
+import threading
+import time
+
+
+class Stats:
+    def __init__(self) -> None:
+        self.lock = threading.Lock()
+        self.connections = 0
+        self.requests = 0
+        self.bytes = 0
+
+    def __repr__(self) -> str:
+        return f"{self.connections} TLS handshakes, {self.requests} " \
+            f"requests, {self.bytes} bytes"
+
+
+def make_handler(root, stats):
+    class Handler(http.server.SimpleHTTPRequestHandler):
+        protocol_version = "HTTP/1.1"
+
+        def __init__(self, *args, **kwargs):
+            super().__init__(*args, directory=root, **kwargs)
+
+        def setup(self):
+            super().setup()
+            # headers and body are separate writes, don't wait for ACKs
+            self.connection.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY,
+                                       1)
+            self.requests = 0
+            with stats.lock:
+                stats.connections += 1
+
+        def finish(self):
+            super().finish()
+            print(f"{self.client_address[0]}: connection closed after "
+                  f"{self.requests} requests")
+
+        def send_head(self):
+            self.requests += 1
+            f = super().send_head()
+            if f is not None:
+                with stats.lock:
+                    stats.requests += 1
+                    stats.bytes += os.fstat(f.fileno()).st_size
+            return f
+
+    return Handler
+
+
+def serve(args):
+    stats = Stats()
+    server = http.server.ThreadingHTTPServer(
+        (args.host, args.port), make_handler(args.root, stats))
+    scheme = "http"
+    if args.cert:
+        context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+        context.load_cert_chain(args.cert, args.key)
+        server.socket = context.wrap_socket(server.socket, server_side=True)
+        scheme = "https"
+    print(f"Serving '{args.root}' on {scheme}://{args.host}:{args.port}/")
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    print(stats)
+
+
+def compress(args):
+    count = 0
+    size = 0
+    compressed = 0
+    for path in glob.glob(os.path.join(args.root, "*x*", "*.bmp")):
+        with open(path, "rb") as f:
+            data = f.read()
+        # no name and time in the header, same icon gives the same file
+        packed = gzip.compress(data, compresslevel=9, mtime=0)
+        with open(path + ".gz", "wb") as f:
+            f.write(packed)
+        count += 1
+        size += len(data)
+        compressed += len(packed)
+    if count == 0:
+        print(f"No icons in '{args.root}'")
+        return
+    print(f"{count} icons, {size} -> {compressed} bytes "
+          f"({size / compressed:.1f}x)")
+
+
+def icon_paths(args, ext="bmp"):
+    for name in args.icons.split(","):
+        for size in args.sizes.split(","):
+            yield f"/{size}x{size}/{name}.{ext}"
+
+
+def get(connection, path):
+    connection.request("GET", path)
+    response = connection.getresponse()
+    body = response.read()
+    if response.status != 200:
+        raise RuntimeError(f"GET {path} failed with {response.status}")
+    return len(body)
+
+
+def bench(args):
+    paths = list(icon_paths(args))
+
+    def connect():
+        if not args.cert:
+            return http.client.HTTPConnection(args.host, args.port)
+        context = ssl.create_default_context(cafile=args.cert)
+        return http.client.HTTPSConnection(args.host, args.port,
+                                           context=context)
+
+    results = {}
+    for mode in ("per request", "keep-alive"):
+        total = 0.0
+        size = 0
+        for _ in range(args.repeat):
+            start = time.perf_counter()
+            connection = connect()
+            for path in paths:
+                if mode == "per request":
+                    connection.close()
+                    connection = connect()
+                size += get(connection, path)
+            connection.close()
+            total += time.perf_counter() - start
+        results[mode] = total / args.repeat
+        print(f"{mode:>12}: {len(paths)} icons, {size // args.repeat} "
+              f"bytes in {1000 * results[mode]:.1f} ms")
+    print(f"speedup: {results['per request'] / results['keep-alive']:.2f}x")
+
+    # plain vs. gzipped over one connection, per icon
+    results = {}
+    for ext in ("bmp", "bmp.gz"):
+        ext_paths = list(icon_paths(args, ext))
+        total = 0.0
+        size = 0
+        for _ in range(args.repeat):
+            start = time.perf_counter()
+            connection = connect()
+            for path in ext_paths:
+                size += get(connection, path)
+            connection.close()
+            total += time.perf_counter() - start
+        results[ext] = (total / args.repeat / len(ext_paths),
+                        size / args.repeat / len(ext_paths))
+        print(f"{ext:>12}: {results[ext][1]:.0f} bytes, "
+              f"{1000 * results[ext][0]:.2f} ms per icon")
+    print(f"gzip: {results['bmp'][1] / results['bmp.gz'][1]:.2f}x fewer "
+          f"bytes, {results['bmp'][0] / results['bmp.gz'][0]:.2f}x speedup")
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Local icon server")
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    serve_parser = commands.add_parser("serve", help="serve icons")
+    serve_parser.add_argument("--root", required=True,
+                              help="folder with <size>x<size>/<name>.bmp")
+    serve_parser.add_argument("--host", default="0.0.0.0")
+    serve_parser.add_argument("--port", type=int, default=8443)
+    serve_parser.add_argument("--cert", help="serve HTTPS with this "
+                              "certificate, plain HTTP without")
+    serve_parser.add_argument("--key")
+
+    compress_parser = commands.add_parser(
+        "compress", help="store <name>.bmp.gz next to every icon")
+    compress_parser.add_argument("--root", required=True,
+                                 help="folder with <size>x<size>/<name>.bmp")
+
+    bench_parser = commands.add_parser(
+        "bench", help="compare connection per request vs. keep-alive")
+    bench_parser.add_argument("--host", default="localhost")
+    bench_parser.add_argument("--port", type=int, default=8443)
+    bench_parser.add_argument("--cert", help="server certificate to trust, "
+                              "plain HTTP without")
+    bench_parser.add_argument("--icons", default="lightbulb,fan,television,"
+                              "blinds,garage,lock")
+    bench_parser.add_argument("--sizes", default="64,48")
+    bench_parser.add_argument("--repeat", type=int, default=5)
+
+    args = parser.parse_args()
+    if args.command == "serve":
+        serve(args)
+    elif args.command == "compress":
+        compress(args)
+    else:
+        bench(args)
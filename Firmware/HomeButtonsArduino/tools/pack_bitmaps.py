@@ -0,0 +1,82 @@
+#!/usr/bin/env python
+
+# Converts the XBM arrays in src/display/bitmaps.h (LSB first) into the
+# framebuffer bit order (MSB first, rows byte aligned) used by Display::blit().
+# Output: src/display/bitmaps_packed.h
+
+import argparse
+import os
+import re
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+DEFAULT_INPUT = os.path.join(SCRIPT_DIR, "..", "src", "display", "bitmaps.h")
+DEFAULT_OUTPUT = os.path.join(
+    SCRIPT_DIR, "..", "src", "display", "bitmaps_packed.h")
+
+ARRAY_RE = re.compile(
+    r"const unsigned char (\w+?)_(\d+)x(\d+)\[\] PROGMEM = \{([^}]*)\};")
+
+
+def reverse_bits(byte):
+    return int("{:08b}".format(byte)[::-1], 2)
+
+
+def parse(text):
+    bitmaps = []
+    for match in ARRAY_RE.finditer(text):
+        name, width, height, body = match.groups()
+        data = [int(v, 16) for v in re.findall(r"0x[0-9a-fA-F]{2}", body)]
+        width, height = int(width), int(height)
+        expected = (width + 7) // 8 * height
+        if len(data) != expected:
+            raise ValueError("{}_{}x{}: {} bytes, expected {}".format(
+                name, width, height, len(data), expected))
+        bitmaps.append((name, width, height, data))
+    return bitmaps
+
+
+def render(bitmaps):
+    lines = [
+        "// Generated by tools/pack_bitmaps.py from bitmaps.h - do not edit.",
+        "// 1-bpp, MSB first, rows byte aligned (framebuffer bit order).",
+        "",
+        "#ifndef HOMEBUTTONS_BITMAPS_PACKED_H",
+        "#define HOMEBUTTONS_BITMAPS_PACKED_H",
+        "",
+        "#include <pgmspace.h>",
+        "",
+    ]
+    for name, width, height, data in bitmaps:
+        lines.append(
+            "const unsigned char {}_{}x{}_packed[] PROGMEM = {{".format(
+                name, width, height))
+        packed = [reverse_bits(b) for b in data]
+        rows = ["0x{:02x}".format(b) for b in packed]
+        for i in range(0, len(rows), 12):
+            suffix = "," if i + 12 < len(rows) else "};"
+            lines.append("    " + ", ".join(rows[i:i + 12]) + suffix)
+        lines.append("")
+    lines.append("#endif  // HOMEBUTTONS_BITMAPS_PACKED_H")
+    return "\n".join(lines) + "\n"
+
+
+def generate(input_path=DEFAULT_INPUT, output_path=DEFAULT_OUTPUT):
+    with open(input_path) as f:
+        bitmaps = parse(f.read())
+    content = render(bitmaps)
+    if os.path.isfile(output_path):
+        with open(output_path) as f:
+            if f.read() == content:
+                return False
+    with open(output_path, "w") as f:
+        f.write(content)
+    print("Packed {} bitmaps to {}".format(len(bitmaps), output_path))
+    return True
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("-i", "--input", default=DEFAULT_INPUT)
+    parser.add_argument("-o", "--output", default=DEFAULT_OUTPUT)
+    args = parser.parse_args()
+    generate(args.input, args.output)
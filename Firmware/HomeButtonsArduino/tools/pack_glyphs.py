@@ -0,0 +1,307 @@
+#!/usr/bin/env python
+
+# Packs the outlines of the Material Design Icons into /glyphs.bin on the
+# icon storage, read by GlyphFont (src/mdi/glyph_font.cpp). Icons in the
+# font are rasterized on the device at any size, without downloads.
+#
+# Input is the svg/ folder of the @mdi/svg package (one <name>.svg per icon,
+# a single path on a 24x24 view box). The font goes into the file system
+# image built from data/ and is flashed over USB:
+#
+#   npm pack @mdi/svg && tar xzf mdi-svg-*.tgz
+#   tools/pack_glyphs.py --svg package/svg --output data/glyphs.bin
+#   pio run -e original_release -t uploadfs
+#
+# uploadfs replaces the whole "spiffs" partition, icons stored on the device
+# are downloaded again. Builds with HOME_BUTTONS_ICONS_LITTLEFS need
+# board_build.filesystem = littlefs. Devices updated over the air have no
+# font and download all icons, as before.
+#
+# --icons limits the font to the names listed in a file (one per line) when
+# the whole set doesn't fit --max-size.
+#
+# Image layout (little endian):
+#   header   magic "HBGL", version, units per 24 px, icon and block count,
+#            image size
+#   index    (FNV-1a hash of the name, block, offset in block) sorted by hash
+#   blocks   (offset in image, deflated length, length)
+#   data     raw deflate streams of up to BLOCK_SIZE bytes of glyphs
+#
+# A glyph is its number of path operations (uint16), the operations packed
+# 4 per byte (2 bits each, first in the low bits: move, line, quad, cubic)
+# and the end and control points, one byte per coordinate in 1/10 of the
+# view box unit. Contours are closed by the rasterizer.
+
+import argparse
+import glob
+import math
+import os
+import re
+import struct
+import zlib
+
+MAGIC = 0x4C474248  # "HBGL"
+VERSION = 1
+UNITS = 240  # per 24 px view box
+BLOCK_SIZE = 4096  # MDI_GLYPH_BLOCK in src/config.h
+# half of the "spiffs" partition, the rest is left for downloaded icons
+MAX_SIZE = 0xB0000
+
+MOVE, LINE, QUAD, CUBIC = range(4)
+
+PATH_RE = re.compile(r'<path[^>]*\sd="([^"]+)"')
+TOKEN_RE = re.compile(
+    r"[MmLlHhVvCcSsQqTtAaZz]|[-+]?(?:\d+\.?\d*|\.\d+)(?:[eE][-+]?\d+)?")
+
+
+def fnv1a(name):
+    h = 0x811C9DC5
+    for b in name.encode():
+        h = ((h ^ b) * 0x01000193) & 0xFFFFFFFF
+    return h
+
+
+def arc_to_cubics(x0, y0, rx, ry, angle, large, sweep, x, y):
+    # SVG arc implementation notes, F.6.5 and F.6.6
+    if rx == 0 or ry == 0:
+        return [(LINE, [(x, y)])]
+    phi = math.radians(angle)
+    cos_phi, sin_phi = math.cos(phi), math.sin(phi)
+    dx, dy = (x0 - x) / 2, (y0 - y) / 2
+    x1p = cos_phi * dx + sin_phi * dy
+    y1p = -sin_phi * dx + cos_phi * dy
+    rx, ry = abs(rx), abs(ry)
+    scale = (x1p / rx) ** 2 + (y1p / ry) ** 2
+    if scale > 1:
+        rx *= math.sqrt(scale)
+        ry *= math.sqrt(scale)
+    num = rx * rx * ry * ry - rx * rx * y1p * y1p - ry * ry * x1p * x1p
+    den = rx * rx * y1p * y1p + ry * ry * x1p * x1p
+    coef = math.sqrt(max(0, num / den)) if den else 0
+    if large == sweep:
+        coef = -coef
+    cxp = coef * rx * y1p / ry
+    cyp = -coef * ry * x1p / rx
+    cx = cos_phi * cxp - sin_phi * cyp + (x0 + x) / 2
+    cy = sin_phi * cxp + cos_phi * cyp + (y0 + y) / 2
+
+    def angle_of(ux, uy):
+        return math.atan2(uy, ux)
+
+    theta = angle_of((x1p - cxp) / rx, (y1p - cyp) / ry)
+    delta = angle_of((-x1p - cxp) / rx, (-y1p - cyp) / ry) - theta
+    if sweep and delta < 0:
+        delta += 2 * math.pi
+    elif not sweep and delta > 0:
+        delta -= 2 * math.pi
+
+    # one cubic per quarter turn at most
+    count = max(1, math.ceil(abs(delta) / (math.pi / 2) - 1e-9))
+    step = delta / count
+    k = 4 / 3 * math.tan(step / 4)
+    ops = []
+
+    def point(t):
+        return (cx + rx * math.cos(t) * cos_phi - ry * math.sin(t) * sin_phi,
+                cy + rx * math.cos(t) * sin_phi + ry * math.sin(t) * cos_phi)
+
+    def tangent(t):
+        return (-rx * math.sin(t) * cos_phi - ry * math.cos(t) * sin_phi,
+                -rx * math.sin(t) * sin_phi + ry * math.cos(t) * cos_phi)
+
+    for i in range(count):
+        t1 = theta + i * step
+        t2 = t1 + step
+        p1, p2 = point(t1), point(t2)
+        d1, d2 = tangent(t1), tangent(t2)
+        ops.append((CUBIC, [(p1[0] + k * d1[0], p1[1] + k * d1[1]),
+                            (p2[0] - k * d2[0], p2[1] - k * d2[1]),
+                            (x, y) if i == count - 1 else p2]))
+    return ops
+
+
+def parse_path(d):
+    tokens = TOKEN_RE.findall(d)
+    ops = []
+    pos = 0
+    cmd = None
+    x = y = 0.0
+    start = (0.0, 0.0)
+    last_control = None  # reflected by S and T
+    last_cmd = ""
+
+    def number():
+        nonlocal pos
+        value = float(tokens[pos])
+        pos += 1
+        return value
+
+    while pos < len(tokens):
+        if tokens[pos].isalpha():
+            cmd = tokens[pos]
+            pos += 1
+        elif cmd is None:
+            raise ValueError("path data doesn't start with a command")
+        rel = cmd.islower()
+        c = cmd.upper()
+        ox, oy = (x, y) if rel else (0.0, 0.0)
+        control = None
+        if c == "Z":
+            ops.append(None)  # contour end, closed by the rasterizer
+            x, y = start
+            cmd = None
+        elif c == "M":
+            x, y = ox + number(), oy + number()
+            start = (x, y)
+            ops.append((MOVE, [(x, y)]))
+            # further pairs are line-tos
+            cmd = "l" if rel else "L"
+        elif c == "L":
+            x, y = ox + number(), oy + number()
+            ops.append((LINE, [(x, y)]))
+        elif c == "H":
+            x = ox + number()
+            ops.append((LINE, [(x, y)]))
+        elif c == "V":
+            y = oy + number()
+            ops.append((LINE, [(x, y)]))
+        elif c in "CS":
+            if c == "C":
+                c1 = (ox + number(), oy + number())
+            elif last_cmd in "CS" and last_control:
+                c1 = (2 * x - last_control[0], 2 * y - last_control[1])
+            else:
+                c1 = (x, y)
+            c2 = (ox + number(), oy + number())
+            x, y = ox + number(), oy + number()
+            ops.append((CUBIC, [c1, c2, (x, y)]))
+            control = c2
+        elif c in "QT":
+            if c == "Q":
+                c1 = (ox + number(), oy + number())
+            elif last_cmd in "QT" and last_control:
+                c1 = (2 * x - last_control[0], 2 * y - last_control[1])
+            else:
+                c1 = (x, y)
+            x, y = ox + number(), oy + number()
+            ops.append((QUAD, [c1, (x, y)]))
+            control = c1
+        elif c == "A":
+            rx, ry, angle = number(), number(), number()
+            large, sweep = number() != 0, number() != 0
+            x0, y0 = x, y
+            x, y = ox + number(), oy + number()
+            ops.extend(arc_to_cubics(x0, y0, rx, ry, angle, large, sweep, x,
+                                     y))
+        last_control = control
+        last_cmd = c
+    return [op for op in ops if op is not None]
+
+
+def quantize(value):
+    return min(255, max(0, round(value * UNITS / 24)))
+
+
+def encode_glyph(ops):
+    codes = bytearray((len(ops) + 3) // 4)
+    points = bytearray()
+    for i, (op, pts) in enumerate(ops):
+        codes[i // 4] |= op << (2 * (i % 4))
+        for px, py in pts:
+            points += bytes((quantize(px), quantize(py)))
+    return struct.pack("<H", len(ops)) + bytes(codes) + bytes(points)
+
+
+def read_icons(svg_dir, names):
+    icons = []
+    for path in sorted(glob.glob(os.path.join(svg_dir, "*.svg"))):
+        name = os.path.splitext(os.path.basename(path))[0]
+        if names is not None and name not in names:
+            continue
+        with open(path) as f:
+            paths = PATH_RE.findall(f.read())
+        if not paths:
+            print(f"{name}: no path, skipped")
+            continue
+        ops = []
+        for d in paths:
+            ops += parse_path(d)
+        icons.append((name, encode_glyph(ops)))
+    return icons
+
+
+def pack(icons):
+    hashes = {}
+    for name, _ in icons:
+        h = fnv1a(name)
+        if h in hashes:
+            raise ValueError(f"'{name}' and '{hashes[h]}' have the same hash")
+        hashes[h] = name
+
+    blocks = []  # raw data
+    index = []
+    block = bytearray()
+    for name, glyph in icons:
+        if len(glyph) > BLOCK_SIZE:
+            print(f"{name}: {len(glyph)} bytes, larger than a block, skipped")
+            continue
+        if len(block) + len(glyph) > BLOCK_SIZE:
+            blocks.append(bytes(block))
+            block = bytearray()
+        index.append((fnv1a(name), len(blocks), len(block)))
+        block += glyph
+    if block:
+        blocks.append(bytes(block))
+    index.sort()
+
+    compressed = []
+    for raw in blocks:
+        deflate = zlib.compressobj(9, zlib.DEFLATED, -15)
+        compressed.append(deflate.compress(raw) + deflate.flush())
+
+    header_size = 20
+    data_offset = header_size + 8 * len(index) + 8 * len(blocks)
+    block_table = bytearray()
+    offset = data_offset
+    for raw, data in zip(blocks, compressed):
+        block_table += struct.pack("<IHH", offset, len(data), len(raw))
+        offset += len(data)
+    header = struct.pack("<IHHIII", MAGIC, VERSION, UNITS, len(index),
+                         len(blocks), offset)
+    image = header + b"".join(struct.pack("<IHH", *entry) for entry in index)
+    image += block_table + b"".join(compressed)
+    raw_size = sum(len(raw) for raw in blocks)
+    return image, raw_size
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Pack MDI glyph outlines")
+    parser.add_argument("--svg", required=True,
+                        help="folder with <name>.svg of @mdi/svg")
+    parser.add_argument("--icons", help="file with the names to pack, one "
+                        "per line, all icons without")
+    parser.add_argument("--output", default="glyphs.bin")
+    parser.add_argument("--max-size", type=lambda v: int(v, 0),
+                        default=MAX_SIZE)
+    args = parser.parse_args()
+
+    names = None
+    if args.icons:
+        with open(args.icons) as f:
+            names = {line.strip() for line in f if line.strip()}
+    icons = read_icons(args.svg, names)
+    if not icons:
+        raise SystemExit(f"No icons in '{args.svg}'")
+    image, raw_size = pack(icons)
+    print(f"{len(icons)} icons, {raw_size} bytes of outlines, image "
+          f"{len(image)} bytes ({len(image) / len(icons):.0f} per icon)")
+    if len(image) > args.max_size:
+        raise SystemExit(f"Font larger than {args.max_size} bytes, use "
+                         f"--icons")
+    with open(args.output, "wb") as f:
+        f.write(image)
+    print(f"Written to '{args.output}'")
+
+
+if __name__ == "__main__":
+    main()